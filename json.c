@@ -0,0 +1,775 @@
+/*
+ * ProFTPD - mod_conf_sql JSON implementation
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+#include "json.h"
+
+static const char *json_skip_space(const char *ptr, const char *end) {
+  while (ptr < end &&
+         (*ptr == ' ' || *ptr == '\t' || *ptr == '\r' || *ptr == '\n')) {
+    ptr++;
+  }
+
+  return ptr;
+}
+
+static int json_hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+
+  return -1;
+}
+
+static int json_parse_hex4(const char *ptr, const char *end,
+    unsigned int *cp) {
+  register unsigned int i;
+
+  if (end - ptr < 4) {
+    return -1;
+  }
+
+  *cp = 0;
+  for (i = 0; i < 4; i++) {
+    int v;
+
+    v = json_hex_value(ptr[i]);
+    if (v < 0) {
+      return -1;
+    }
+
+    *cp = (*cp << 4) | v;
+  }
+
+  return 0;
+}
+
+static char *json_encode_utf8(char *dst, unsigned int cp) {
+  if (cp < 0x80) {
+    *dst++ = (char) cp;
+
+  } else if (cp < 0x800) {
+    *dst++ = (char) (0xC0 | (cp >> 6));
+    *dst++ = (char) (0x80 | (cp & 0x3F));
+
+  } else if (cp < 0x10000) {
+    *dst++ = (char) (0xE0 | (cp >> 12));
+    *dst++ = (char) (0x80 | ((cp >> 6) & 0x3F));
+    *dst++ = (char) (0x80 | (cp & 0x3F));
+
+  } else {
+    *dst++ = (char) (0xF0 | (cp >> 18));
+    *dst++ = (char) (0x80 | ((cp >> 12) & 0x3F));
+    *dst++ = (char) (0x80 | ((cp >> 6) & 0x3F));
+    *dst++ = (char) (0x80 | (cp & 0x3F));
+  }
+
+  return dst;
+}
+
+/* Skips the JSON string starting at the opening quote pointed to by ptr,
+ * returning a pointer to the character after the closing quote, or NULL if
+ * the string is unterminated.
+ */
+static const char *json_skip_string(const char *ptr, const char *end) {
+  ptr++;
+
+  while (ptr < end) {
+    char c;
+
+    c = *ptr++;
+    if (c == '"') {
+      return ptr;
+    }
+
+    if (c == '\\') {
+      if (ptr == end) {
+        break;
+      }
+
+      ptr++;
+    }
+  }
+
+  return NULL;
+}
+
+/* Parses the JSON string starting at the opening quote pointed to by ptr.
+ * On success, returns a pointer to the character after the closing quote.
+ */
+static const char *json_parse_string(pool *p, const char *ptr,
+    const char *end, char **str) {
+  const char *next;
+  char *dst;
+
+  next = json_skip_string(ptr, end);
+  if (next == NULL) {
+    return NULL;
+  }
+
+  /* The unescaped string is never longer than the escaped one; only the
+   * string itself is allocated, not the rest of the text after it.
+   */
+  ptr++;
+  end = next - 1;
+  *str = dst = palloc(p, (end - ptr) + 1);
+
+  while (ptr < end) {
+    char c;
+
+    c = *ptr++;
+
+    if (c != '\\') {
+      *dst++ = c;
+      continue;
+    }
+
+    if (ptr == end) {
+      break;
+    }
+
+    c = *ptr++;
+    switch (c) {
+      case '"':
+      case '\\':
+      case '/':
+        *dst++ = c;
+        break;
+
+      case 'b':
+        *dst++ = '\b';
+        break;
+
+      case 'f':
+        *dst++ = '\f';
+        break;
+
+      case 'n':
+        *dst++ = '\n';
+        break;
+
+      case 'r':
+        *dst++ = '\r';
+        break;
+
+      case 't':
+        *dst++ = '\t';
+        break;
+
+      case 'u': {
+        unsigned int cp;
+
+        if (json_parse_hex4(ptr, end, &cp) < 0) {
+          return NULL;
+        }
+        ptr += 4;
+
+        /* Handle UTF-16 surrogate pairs. */
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+          unsigned int lo;
+
+          if (end - ptr < 6 ||
+              ptr[0] != '\\' ||
+              ptr[1] != 'u' ||
+              json_parse_hex4(ptr + 2, end, &lo) < 0 ||
+              lo < 0xDC00 ||
+              lo > 0xDFFF) {
+            return NULL;
+          }
+          ptr += 6;
+
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+        }
+
+        /* A \uXXXX escape takes 6 bytes, and encodes to at most 3 bytes;
+         * a surrogate pair takes 12 bytes, and encodes to 4.
+         */
+        dst = json_encode_utf8(dst, cp);
+        break;
+      }
+
+      default:
+        return NULL;
+    }
+  }
+
+  *dst = '\0';
+  return next;
+}
+
+int sqlconf_json_parse_strings(pool *p, const char *text, size_t textsz,
+    array_header **strs) {
+  const char *ptr, *end;
+  array_header *list;
+
+  if (p == NULL ||
+      text == NULL ||
+      strs == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  ptr = text;
+  end = text + textsz;
+
+  ptr = json_skip_space(ptr, end);
+  if (ptr == end ||
+      *ptr != '[') {
+    errno = EINVAL;
+    return -1;
+  }
+  ptr++;
+
+  list = make_array(p, 1, sizeof(char *));
+
+  ptr = json_skip_space(ptr, end);
+  if (ptr < end &&
+      *ptr == ']') {
+    ptr = json_skip_space(ptr + 1, end);
+    if (ptr != end) {
+      errno = EINVAL;
+      return -1;
+    }
+
+    *strs = list;
+    return 0;
+  }
+
+  while (ptr < end) {
+    char *str = NULL;
+
+    if (*ptr == '"') {
+      ptr = json_parse_string(p, ptr, end, &str);
+      if (ptr == NULL) {
+        errno = EINVAL;
+        return -1;
+      }
+
+    } else if (*ptr == '[' ||
+               *ptr == '{') {
+      errno = EINVAL;
+      return -1;
+
+    } else {
+      const char *start = ptr;
+
+      /* Numbers and literals; take them as-is. */
+      while (ptr < end &&
+             *ptr != ',' &&
+             *ptr != ']' &&
+             *ptr != ' ' &&
+             *ptr != '\t' &&
+             *ptr != '\r' &&
+             *ptr != '\n') {
+        ptr++;
+      }
+
+      if (ptr == start) {
+        errno = EINVAL;
+        return -1;
+      }
+
+      str = pstrndup(p, start, ptr - start);
+    }
+
+    *((char **) push_array(list)) = str;
+
+    ptr = json_skip_space(ptr, end);
+    if (ptr == end) {
+      break;
+    }
+
+    if (*ptr == ',') {
+      ptr = json_skip_space(ptr + 1, end);
+      continue;
+    }
+
+    if (*ptr == ']') {
+      ptr = json_skip_space(ptr + 1, end);
+      if (ptr != end) {
+        errno = EINVAL;
+        return -1;
+      }
+
+      *strs = list;
+      return 0;
+    }
+
+    break;
+  }
+
+  /* Missing closing bracket, or unexpected characters. */
+  errno = EINVAL;
+  return -1;
+}
+
+/* Configuration document walking
+ */
+
+struct json_walk {
+  pool *pool;
+  const struct sqlconf_json_walker *walker;
+  void *user_data;
+  const char *end;
+  unsigned int depth;
+};
+
+static const char *json_walk_ctx(struct json_walk *walk, const char *ptr);
+
+/* Skips the JSON value starting at ptr, returning a pointer to the character
+ * after it.  Only strings, and the nesting of arrays and objects, are
+ * checked; skipped values are not otherwise validated.
+ */
+static const char *json_skip_value(const char *ptr, const char *end) {
+  const char *start = ptr;
+  unsigned int depth = 0;
+
+  while (ptr < end) {
+    char c;
+
+    c = *ptr;
+
+    if (c == '"') {
+      ptr = json_skip_string(ptr, end);
+      if (ptr == NULL ||
+          depth == 0) {
+        return ptr;
+      }
+
+      continue;
+    }
+
+    if (c == '[' ||
+        c == '{') {
+      depth++;
+
+    } else if (c == ']' ||
+               c == '}') {
+      if (depth == 0) {
+        break;
+      }
+
+      depth--;
+      if (depth == 0) {
+        return ptr + 1;
+      }
+
+    } else if (depth == 0 &&
+               (c == ',' || c == ':' || c == ' ' || c == '\t' ||
+                c == '\r' || c == '\n')) {
+      break;
+    }
+
+    ptr++;
+  }
+
+  /* An unterminated array or object, or an empty scalar. */
+  if (depth > 0 ||
+      ptr == start) {
+    return NULL;
+  }
+
+  return ptr;
+}
+
+/* Walks a directive given as text, splitting off its name. */
+static const char *json_walk_text(struct json_walk *walk, const char *ptr) {
+  pool *tmp_pool;
+  char *str = NULL, *name, *text, *end;
+  int res, xerrno;
+
+  tmp_pool = make_sub_pool(walk->pool);
+  pr_pool_tag(tmp_pool, "SQL Configuration JSON Pool");
+
+  ptr = json_parse_string(tmp_pool, ptr, walk->end, &str);
+  if (ptr == NULL) {
+    destroy_pool(tmp_pool);
+    errno = EINVAL;
+    return NULL;
+  }
+
+  name = str + strspn(str, " \t");
+  text = name + strcspn(name, " \t\r\n");
+  if (text == name) {
+    destroy_pool(tmp_pool);
+    errno = EINVAL;
+    return NULL;
+  }
+
+  if (*text != '\0') {
+    *text++ = '\0';
+    text += strspn(text, " \t");
+  }
+
+  end = text + strlen(text);
+  while (end > text &&
+         (*(end - 1) == ' ' || *(end - 1) == '\t' || *(end - 1) == '\r' ||
+          *(end - 1) == '\n')) {
+    end--;
+  }
+  *end = '\0';
+
+  res = (walk->walker->add_conf)(tmp_pool, walk->user_data, name, text, NULL);
+  xerrno = errno;
+  destroy_pool(tmp_pool);
+
+  if (res < 0) {
+    errno = xerrno;
+    return NULL;
+  }
+
+  return ptr;
+}
+
+/* Walks a directive given as a list of its name and arguments. */
+static const char *json_walk_args(struct json_walk *walk, const char *ptr) {
+  register unsigned int i;
+  pool *tmp_pool;
+  const char *next;
+  array_header *strs = NULL, *args;
+  char **elts;
+  int res, xerrno;
+
+  next = json_skip_value(ptr, walk->end);
+  if (next == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  tmp_pool = make_sub_pool(walk->pool);
+  pr_pool_tag(tmp_pool, "SQL Configuration JSON Pool");
+
+  if (sqlconf_json_parse_strings(tmp_pool, ptr, next - ptr, &strs) < 0 ||
+      strs->nelts == 0) {
+    destroy_pool(tmp_pool);
+    errno = EINVAL;
+    return NULL;
+  }
+
+  elts = strs->elts;
+  args = make_array(tmp_pool, strs->nelts, sizeof(char *));
+  for (i = 1; i < strs->nelts; i++) {
+    *((char **) push_array(args)) = elts[i];
+  }
+
+  res = (walk->walker->add_conf)(tmp_pool, walk->user_data, elts[0], NULL,
+    args);
+  xerrno = errno;
+  destroy_pool(tmp_pool);
+
+  if (res < 0) {
+    errno = xerrno;
+    return NULL;
+  }
+
+  return next;
+}
+
+/* Walks the list of configuration items starting at the opening bracket
+ * pointed to by ptr, returning a pointer to the character after the closing
+ * bracket.
+ */
+static const char *json_walk_items(struct json_walk *walk, const char *ptr) {
+  const char *end;
+
+  end = walk->end;
+
+  ptr = json_skip_space(ptr + 1, end);
+  if (ptr < end &&
+      *ptr == ']') {
+    return ptr + 1;
+  }
+
+  while (ptr < end) {
+    switch (*ptr) {
+      case '"':
+        ptr = json_walk_text(walk, ptr);
+        break;
+
+      case '[':
+        ptr = json_walk_args(walk, ptr);
+        break;
+
+      case '{':
+        ptr = json_walk_ctx(walk, ptr);
+        break;
+
+      default:
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (ptr == NULL) {
+      return NULL;
+    }
+
+    ptr = json_skip_space(ptr, end);
+    if (ptr == end) {
+      break;
+    }
+
+    if (*ptr == ',') {
+      ptr = json_skip_space(ptr + 1, end);
+      continue;
+    }
+
+    if (*ptr == ']') {
+      return ptr + 1;
+    }
+
+    break;
+  }
+
+  /* Missing closing bracket, or unexpected characters. */
+  errno = EINVAL;
+  return NULL;
+}
+
+static const char *json_walk_ctx_error(struct json_walk *walk,
+    pool *ctx_pool, int xerrno) {
+  destroy_pool(ctx_pool);
+  walk->depth--;
+
+  errno = xerrno;
+  return NULL;
+}
+
+/* Walks the context object starting at the opening brace pointed to by ptr,
+ * returning a pointer to the character after the closing brace.
+ *
+ * The context is opened as soon as its type and value are known, so that
+ * its items can be walked as they are read.  Should the "config" list come
+ * first, it is skipped, and walked once the rest of the object has been
+ * read.
+ */
+static const char *json_walk_ctx(struct json_walk *walk, const char *ptr) {
+  pool *ctx_pool;
+  const char *end, *config = NULL;
+  char *type = NULL, *value = NULL;
+  int have_value = FALSE, opened = FALSE, closed = FALSE;
+
+  end = walk->end;
+
+  if (walk->depth >= CONF_SQL_JSON_MAX_DEPTH) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  walk->depth++;
+
+  ctx_pool = make_sub_pool(walk->pool);
+  pr_pool_tag(ctx_pool, "SQL Configuration JSON Context Pool");
+
+  ptr = json_skip_space(ptr + 1, end);
+
+  while (ptr < end &&
+         *ptr == '"') {
+    char *key = NULL;
+
+    ptr = json_parse_string(ctx_pool, ptr, end, &key);
+    if (ptr == NULL) {
+      return json_walk_ctx_error(walk, ctx_pool, EINVAL);
+    }
+
+    ptr = json_skip_space(ptr, end);
+    if (ptr == end ||
+        *ptr != ':') {
+      return json_walk_ctx_error(walk, ctx_pool, EINVAL);
+    }
+
+    ptr = json_skip_space(ptr + 1, end);
+    if (ptr == end) {
+      return json_walk_ctx_error(walk, ctx_pool, EINVAL);
+    }
+
+    if (strcmp(key, "type") == 0) {
+      if (*ptr != '"' ||
+          type != NULL) {
+        return json_walk_ctx_error(walk, ctx_pool, EINVAL);
+      }
+
+      ptr = json_parse_string(ctx_pool, ptr, end, &type);
+
+    } else if (strcmp(key, "value") == 0) {
+      if (have_value == TRUE) {
+        return json_walk_ctx_error(walk, ctx_pool, EINVAL);
+      }
+
+      if (*ptr == '"') {
+        ptr = json_parse_string(ctx_pool, ptr, end, &value);
+
+      } else {
+        const char *start = ptr;
+
+        /* Numbers and literals; take them as-is, but for null. */
+        ptr = json_skip_value(ptr, end);
+        if (ptr != NULL &&
+            (*start == '[' || *start == '{')) {
+          ptr = NULL;
+        }
+
+        if (ptr != NULL &&
+            (ptr - start != 4 || strncmp(start, "null", 4) != 0)) {
+          value = pstrndup(ctx_pool, start, ptr - start);
+        }
+      }
+
+      have_value = TRUE;
+
+    } else if (strcmp(key, "config") == 0) {
+      if (*ptr != '[' ||
+          config != NULL ||
+          opened == TRUE) {
+        return json_walk_ctx_error(walk, ctx_pool, EINVAL);
+      }
+
+      if (type != NULL &&
+          have_value == TRUE) {
+        if ((walk->walker->open_ctx)(ctx_pool, walk->user_data, type,
+            value) < 0) {
+          return json_walk_ctx_error(walk, ctx_pool, errno);
+        }
+
+        opened = TRUE;
+        ptr = json_walk_items(walk, ptr);
+        if (ptr == NULL) {
+          return json_walk_ctx_error(walk, ctx_pool, errno);
+        }
+
+      } else {
+        config = ptr;
+        ptr = json_skip_value(ptr, end);
+      }
+
+    } else {
+      ptr = json_skip_value(ptr, end);
+    }
+
+    if (ptr == NULL) {
+      return json_walk_ctx_error(walk, ctx_pool, EINVAL);
+    }
+
+    ptr = json_skip_space(ptr, end);
+    if (ptr < end &&
+        *ptr == ',') {
+      ptr = json_skip_space(ptr + 1, end);
+      continue;
+    }
+
+    if (ptr < end &&
+        *ptr == '}') {
+      closed = TRUE;
+      ptr++;
+    }
+
+    break;
+  }
+
+  if (closed == FALSE ||
+      type == NULL) {
+    return json_walk_ctx_error(walk, ctx_pool, EINVAL);
+  }
+
+  if (opened == FALSE) {
+    if ((walk->walker->open_ctx)(ctx_pool, walk->user_data, type,
+        value) < 0) {
+      return json_walk_ctx_error(walk, ctx_pool, errno);
+    }
+
+    if (config != NULL &&
+        json_walk_items(walk, config) == NULL) {
+      return json_walk_ctx_error(walk, ctx_pool, errno);
+    }
+  }
+
+  if ((walk->walker->close_ctx)(ctx_pool, walk->user_data, type) < 0) {
+    return json_walk_ctx_error(walk, ctx_pool, errno);
+  }
+
+  destroy_pool(ctx_pool);
+  walk->depth--;
+
+  return ptr;
+}
+
+int sqlconf_json_walk_conf(pool *p, const char *text, size_t textsz,
+    const struct sqlconf_json_walker *walker, void *user_data) {
+  struct json_walk walk;
+  const char *ptr, *end;
+
+  if (p == NULL ||
+      text == NULL ||
+      walker == NULL ||
+      walker->open_ctx == NULL ||
+      walker->close_ctx == NULL ||
+      walker->add_conf == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  end = text + textsz;
+
+  memset(&walk, 0, sizeof(walk));
+  walk.pool = p;
+  walk.walker = walker;
+  walk.user_data = user_data;
+  walk.end = end;
+
+  ptr = json_skip_space(text, end);
+  if (ptr == end) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (*ptr == '[') {
+    ptr = json_walk_items(&walk, ptr);
+
+  } else if (*ptr == '{') {
+    ptr = json_walk_ctx(&walk, ptr);
+
+  } else {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (ptr == NULL) {
+    return -1;
+  }
+
+  ptr = json_skip_space(ptr, end);
+  if (ptr != end) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  return 0;
+}
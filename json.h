@@ -0,0 +1,73 @@
+/*
+ * ProFTPD - mod_conf_sql JSON API
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+
+#ifndef MOD_CONF_SQL_JSON_H
+#define MOD_CONF_SQL_JSON_H
+
+/* Parses the given JSON array, e.g.:
+ *
+ *   ["foo", "bar baz", 7, true]
+ *
+ * into an array of strings.  Strings are unescaped; numbers, booleans and
+ * null are returned as their literal text.  Nested arrays and objects are
+ * rejected.
+ */
+int sqlconf_json_parse_strings(pool *p, const char *text, size_t textsz,
+  array_header **strs);
+
+/* Walks the given configuration document, calling the walker's callbacks
+ * for each context and directive, in order, as they are read.  Nothing is
+ * kept once the callbacks have been called; each is given a scratch pool,
+ * which is destroyed once its context or directive is done.
+ *
+ * The document is either a list of configuration items, for the base
+ * context, or a context object:
+ *
+ *   {"type": "VirtualHost", "value": "127.0.0.1", "config": [...]}
+ *
+ * whose "value" and "config" are optional.  The items of a "config" list
+ * are contexts; directive text, e.g. "Port 2121"; or directive arguments,
+ * e.g. ["AllowUser", "bob", "alice"].  Other keys are ignored.
+ *
+ * Returns -1, with EINVAL, for a malformed document, or with the errno of
+ * a callback which returned -1.
+ */
+#define CONF_SQL_JSON_MAX_DEPTH		64
+
+struct sqlconf_json_walker {
+  int (*open_ctx)(pool *p, void *user_data, const char *type,
+    const char *value);
+  int (*close_ctx)(pool *p, void *user_data, const char *type);
+
+  /* Directives are given either as text, or as their arguments. */
+  int (*add_conf)(pool *p, void *user_data, const char *name,
+    const char *text, array_header *args);
+};
+
+int sqlconf_json_walk_conf(pool *p, const char *text, size_t textsz,
+  const struct sqlconf_json_walker *walker, void *user_data);
+
+#endif /* MOD_CONF_SQL_JSON_H */
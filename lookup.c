@@ -0,0 +1,697 @@
+/*
+ * ProFTPD - mod_conf_sql configuration lookup implementation
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+#include "mod_conf_sql.h"
+#include "lookup.h"
+
+/* Contexts and directives are kept in contiguous arrays, referring to each
+ * other by index.  The directives of a context are adjacent, as are the
+ * arguments of a directive; directives added after a child context are
+ * moved next to their context's others when the build finishes.
+ */
+struct sqlconf_lookup_ctx {
+  const char *type;
+  const char *value;
+
+  int parent;
+  int first_child;
+  int last_child;
+  int next_sibling;
+
+  unsigned int conf_start;
+  unsigned int nconfs;
+};
+
+struct sqlconf_lookup_conf {
+  const char *name;
+
+  unsigned int arg_start;
+  unsigned int argc;
+};
+
+struct sqlconf_lookup_st {
+  pool *pool;
+
+  /* Interned strings, keyed by their text; only needed while building. */
+  pool *build_pool;
+  pr_table_t *strings;
+
+  /* The context of each directive, and whether any directives are not
+   * adjacent to the others of their context; only needed while building.
+   */
+  array_header *conf_ctxs;
+  int unordered;
+
+  array_header *ctxs;
+  array_header *confs;
+  array_header *args;
+
+  /* The currently open context, while building. */
+  int open_idx;
+
+  /* Bytes allocated for the interned strings. */
+  size_t nbytes;
+};
+
+/* The hash chain count for the interned strings table. */
+#define CONF_SQL_LOOKUP_NCHAINS		1024
+
+static sqlconf_lookup_t *lookup_current = NULL;
+
+static const char *trace_channel = "conf_sql";
+
+/* FNV-1a, over the whole key; the table's default key hash does not spread
+ * strings sharing a prefix, such as directive values, across the chains.
+ */
+static unsigned int lookup_string_hash(const void *key, size_t keysz) {
+  const unsigned char *ptr;
+  unsigned int h = 2166136261U;
+
+  ptr = key;
+  while (keysz-- > 0) {
+    h ^= *ptr++;
+    h *= 16777619U;
+  }
+
+  return h;
+}
+
+sqlconf_lookup_t *sqlconf_lookup_create(pool *p) {
+  pool *lookup_pool;
+  sqlconf_lookup_t *lookup;
+  int max_ents = INT_MAX;
+
+  if (p == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  lookup_pool = make_sub_pool(p);
+  pr_pool_tag(lookup_pool, "SQL Configuration Lookup Pool");
+
+  lookup = pcalloc(lookup_pool, sizeof(sqlconf_lookup_t));
+  lookup->pool = lookup_pool;
+
+  lookup->build_pool = make_sub_pool(lookup_pool);
+  pr_pool_tag(lookup->build_pool, "SQL Configuration Lookup Build Pool");
+
+  lookup->strings = pr_table_nalloc(lookup->build_pool, 0,
+    CONF_SQL_LOOKUP_NCHAINS);
+  (void) pr_table_ctl(lookup->strings, PR_TABLE_CTL_SET_MAX_ENTS, &max_ents);
+  (void) pr_table_ctl(lookup->strings, PR_TABLE_CTL_SET_KEY_HASH,
+    (void *) lookup_string_hash);
+
+  lookup->conf_ctxs = make_array(lookup->build_pool, 32, sizeof(int));
+
+  lookup->ctxs = make_array(lookup_pool, 8,
+    sizeof(struct sqlconf_lookup_ctx));
+  lookup->confs = make_array(lookup_pool, 32,
+    sizeof(struct sqlconf_lookup_conf));
+  lookup->args = make_array(lookup_pool, 64, sizeof(char *));
+  lookup->open_idx = -1;
+
+  return lookup;
+}
+
+static const char *lookup_intern(sqlconf_lookup_t *lookup, const char *text) {
+  char *interned;
+  size_t textlen;
+
+  if (text == NULL) {
+    text = "";
+  }
+
+  interned = (char *) pr_table_get(lookup->strings, text, NULL);
+  if (interned != NULL) {
+    return interned;
+  }
+
+  textlen = strlen(text);
+  interned = pstrndup(lookup->pool, text, textlen);
+  lookup->nbytes += textlen + 1;
+
+  if (pr_table_kadd(lookup->strings, interned, textlen + 1, interned,
+      textlen + 1) < 0) {
+    pr_trace_msg(trace_channel, 3, "error interning '%.100s': %s", text,
+      strerror(errno));
+  }
+
+  return interned;
+}
+
+int sqlconf_lookup_open_ctx(sqlconf_lookup_t *lookup, const char *type,
+    const char *value) {
+  struct sqlconf_lookup_ctx *ctx, *ctxs;
+  int idx;
+
+  if (lookup == NULL ||
+      type == NULL ||
+      lookup->strings == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  /* There is only one root context. */
+  if (lookup->open_idx < 0 &&
+      lookup->ctxs->nelts > 0) {
+    errno = EPERM;
+    return -1;
+  }
+
+  idx = lookup->ctxs->nelts;
+  ctx = push_array(lookup->ctxs);
+  ctx->type = lookup_intern(lookup, type);
+  ctx->value = lookup_intern(lookup, value);
+  ctx->parent = lookup->open_idx;
+  ctx->first_child = ctx->last_child = ctx->next_sibling = -1;
+  ctx->conf_start = lookup->confs->nelts;
+  ctx->nconfs = 0;
+
+  /* Note that pushing may have moved the array. */
+  ctxs = lookup->ctxs->elts;
+  if (lookup->open_idx >= 0) {
+    struct sqlconf_lookup_ctx *parent;
+
+    parent = &(ctxs[lookup->open_idx]);
+    if (parent->last_child < 0) {
+      parent->first_child = idx;
+
+    } else {
+      ctxs[parent->last_child].next_sibling = idx;
+    }
+
+    parent->last_child = idx;
+  }
+
+  lookup->open_idx = idx;
+  return idx;
+}
+
+int sqlconf_lookup_close_ctx(sqlconf_lookup_t *lookup) {
+  struct sqlconf_lookup_ctx *ctxs;
+
+  if (lookup == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (lookup->open_idx < 0) {
+    errno = EPERM;
+    return -1;
+  }
+
+  ctxs = lookup->ctxs->elts;
+  lookup->open_idx = ctxs[lookup->open_idx].parent;
+  return 0;
+}
+
+int sqlconf_lookup_add_conf(sqlconf_lookup_t *lookup, const char *name,
+    unsigned int argc, char **argv) {
+  register unsigned int i;
+  struct sqlconf_lookup_ctx *ctx, *ctxs;
+  struct sqlconf_lookup_conf *conf;
+
+  if (lookup == NULL ||
+      name == NULL ||
+      (argc > 0 && argv == NULL) ||
+      lookup->strings == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (lookup->open_idx < 0) {
+    errno = EPERM;
+    return -1;
+  }
+
+  ctxs = lookup->ctxs->elts;
+  ctx = &(ctxs[lookup->open_idx]);
+
+  /* Directives following a child context's are reordered by
+   * sqlconf_lookup_finish().
+   */
+  if (ctx->nconfs == 0) {
+    ctx->conf_start = lookup->confs->nelts;
+
+  } else if (ctx->conf_start + ctx->nconfs != lookup->confs->nelts) {
+    lookup->unordered = TRUE;
+  }
+
+  *((int *) push_array(lookup->conf_ctxs)) = lookup->open_idx;
+
+  conf = push_array(lookup->confs);
+  conf->name = lookup_intern(lookup, name);
+  conf->arg_start = lookup->args->nelts;
+  conf->argc = argc;
+
+  for (i = 0; i < argc; i++) {
+    *((const char **) push_array(lookup->args)) = lookup_intern(lookup,
+      argv[i]);
+  }
+
+  ctx->nconfs++;
+  return 0;
+}
+
+/* Split the given text into words, as the configuration parser does: words
+ * are separated by whitespace, unless double-quoted, and a backslash within
+ * quotes escapes the following character.
+ */
+static array_header *lookup_split_text(pool *p, const char *text) {
+  array_header *words;
+  const char *ptr;
+
+  words = make_array(p, 4, sizeof(char *));
+  ptr = text;
+
+  while (ptr != NULL &&
+         *ptr != '\0') {
+    char *word, *dst;
+
+    while (isspace((int) ((unsigned char) *ptr))) {
+      ptr++;
+    }
+
+    if (*ptr == '\0') {
+      break;
+    }
+
+    word = dst = palloc(p, strlen(ptr) + 1);
+
+    if (*ptr == '"') {
+      ptr++;
+
+      while (*ptr != '\0' &&
+             *ptr != '"') {
+        if (*ptr == '\\' &&
+            *(ptr + 1) != '\0') {
+          ptr++;
+        }
+
+        *dst++ = *ptr++;
+      }
+
+      if (*ptr == '"') {
+        ptr++;
+      }
+
+    } else {
+      while (*ptr != '\0' &&
+             !isspace((int) ((unsigned char) *ptr))) {
+        *dst++ = *ptr++;
+      }
+    }
+
+    *dst = '\0';
+    *((char **) push_array(words)) = word;
+  }
+
+  return words;
+}
+
+int sqlconf_lookup_add_conf_text(sqlconf_lookup_t *lookup, const char *name,
+    const char *value) {
+  array_header *words;
+  pool *tmp_pool;
+  int res, xerrno;
+
+  if (lookup == NULL ||
+      lookup->strings == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  tmp_pool = make_sub_pool(lookup->build_pool);
+  words = lookup_split_text(tmp_pool, value);
+
+  res = sqlconf_lookup_add_conf(lookup, name, words->nelts, words->elts);
+  xerrno = errno;
+
+  destroy_pool(tmp_pool);
+  errno = xerrno;
+  return res;
+}
+
+/* Moves the directives of each context next to each other, keeping their
+ * order, with the contexts' directives in context order.
+ */
+static void lookup_sort_confs(sqlconf_lookup_t *lookup) {
+  register unsigned int i;
+  struct sqlconf_lookup_ctx *ctxs;
+  struct sqlconf_lookup_conf *confs, *unsorted;
+  unsigned int *next, start = 0;
+  int *conf_ctxs;
+
+  ctxs = lookup->ctxs->elts;
+  confs = lookup->confs->elts;
+  conf_ctxs = lookup->conf_ctxs->elts;
+
+  unsorted = palloc(lookup->build_pool,
+    lookup->confs->nelts * sizeof(struct sqlconf_lookup_conf));
+  memcpy(unsorted, confs,
+    lookup->confs->nelts * sizeof(struct sqlconf_lookup_conf));
+
+  next = palloc(lookup->build_pool, lookup->ctxs->nelts * sizeof(unsigned int));
+  for (i = 0; i < lookup->ctxs->nelts; i++) {
+    ctxs[i].conf_start = next[i] = start;
+    start += ctxs[i].nconfs;
+  }
+
+  for (i = 0; i < lookup->confs->nelts; i++) {
+    confs[next[conf_ctxs[i]]++] = unsorted[i];
+  }
+
+  lookup->unordered = FALSE;
+}
+
+int sqlconf_lookup_finish(sqlconf_lookup_t *lookup) {
+  if (lookup == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (lookup->build_pool != NULL) {
+    if (lookup->unordered == TRUE) {
+      lookup_sort_confs(lookup);
+    }
+
+    destroy_pool(lookup->build_pool);
+    lookup->build_pool = NULL;
+    lookup->strings = NULL;
+    lookup->conf_ctxs = NULL;
+  }
+
+  lookup->open_idx = -1;
+
+  pr_trace_msg(trace_channel, 9,
+    "lookup: %u contexts, %u directives, %u arguments, %lu bytes",
+    lookup->ctxs->nelts, lookup->confs->nelts, lookup->args->nelts,
+    (unsigned long) sqlconf_lookup_get_size(lookup));
+  return 0;
+}
+
+void sqlconf_lookup_destroy(sqlconf_lookup_t *lookup) {
+  if (lookup == NULL) {
+    return;
+  }
+
+  if (lookup == lookup_current) {
+    lookup_current = NULL;
+  }
+
+  destroy_pool(lookup->pool);
+}
+
+void sqlconf_lookup_use(sqlconf_lookup_t *lookup) {
+  if (lookup_current != NULL &&
+      lookup_current != lookup) {
+    destroy_pool(lookup_current->pool);
+  }
+
+  lookup_current = lookup;
+}
+
+size_t sqlconf_lookup_get_size(sqlconf_lookup_t *lookup) {
+  if (lookup == NULL) {
+    return 0;
+  }
+
+  return lookup->nbytes +
+    (lookup->ctxs->nelts * sizeof(struct sqlconf_lookup_ctx)) +
+    (lookup->confs->nelts * sizeof(struct sqlconf_lookup_conf)) +
+    (lookup->args->nelts * sizeof(char *));
+}
+
+/* Lookup API
+ */
+
+static struct sqlconf_lookup_ctx *lookup_get_ctx(int ctx_idx) {
+  struct sqlconf_lookup_ctx *ctxs;
+
+  if (lookup_current == NULL) {
+    errno = EPERM;
+    return NULL;
+  }
+
+  if (ctx_idx < 0 ||
+      (unsigned int) ctx_idx >= lookup_current->ctxs->nelts) {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  ctxs = lookup_current->ctxs->elts;
+  return &(ctxs[ctx_idx]);
+}
+
+/* Returns TRUE if the given context matches the given section header text,
+ * which has the form "type[ value]".
+ */
+static int lookup_match_ctx(struct sqlconf_lookup_ctx *ctx, const char *text,
+    size_t textlen) {
+  const char *value;
+  size_t typelen, valuelen;
+
+  for (typelen = 0; typelen < textlen; typelen++) {
+    if (isspace((int) ((unsigned char) text[typelen]))) {
+      break;
+    }
+  }
+
+  if (strlen(ctx->type) != typelen ||
+      strncasecmp(ctx->type, text, typelen) != 0) {
+    return FALSE;
+  }
+
+  value = text + typelen;
+  valuelen = textlen - typelen;
+
+  while (valuelen > 0 &&
+         isspace((int) ((unsigned char) *value))) {
+    value++;
+    valuelen--;
+  }
+
+  while (valuelen > 0 &&
+         isspace((int) ((unsigned char) value[valuelen-1]))) {
+    valuelen--;
+  }
+
+  if (strlen(ctx->value) != valuelen ||
+      strncmp(ctx->value, value, valuelen) != 0) {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+int conf_sql_lookup_ctx(int ctx_idx, const char *path) {
+  struct sqlconf_lookup_ctx *ctx, *ctxs;
+  const char *ptr;
+
+  if (path == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  ctx = lookup_get_ctx(ctx_idx);
+  if (ctx == NULL) {
+    return -1;
+  }
+
+  ctxs = lookup_current->ctxs->elts;
+  ptr = path;
+
+  while (TRUE) {
+    const char *end;
+    int child_idx;
+
+    while (isspace((int) ((unsigned char) *ptr))) {
+      ptr++;
+    }
+
+    if (*ptr == '\0') {
+      break;
+    }
+
+    if (*ptr != '<') {
+      errno = EINVAL;
+      return -1;
+    }
+
+    ptr++;
+    end = strchr(ptr, '>');
+    if (end == NULL) {
+      errno = EINVAL;
+      return -1;
+    }
+
+    for (child_idx = ctx->first_child; child_idx >= 0;
+        child_idx = ctxs[child_idx].next_sibling) {
+      if (lookup_match_ctx(&(ctxs[child_idx]), ptr, end - ptr) == TRUE) {
+        break;
+      }
+    }
+
+    if (child_idx < 0) {
+      errno = ENOENT;
+      return -1;
+    }
+
+    ctx_idx = child_idx;
+    ctx = &(ctxs[ctx_idx]);
+    ptr = end + 1;
+  }
+
+  return ctx_idx;
+}
+
+int conf_sql_lookup_ctx_info(int ctx_idx, const char **type,
+    const char **value, int *parent_idx) {
+  struct sqlconf_lookup_ctx *ctx;
+
+  ctx = lookup_get_ctx(ctx_idx);
+  if (ctx == NULL) {
+    return -1;
+  }
+
+  if (type != NULL) {
+    *type = ctx->type;
+  }
+
+  if (value != NULL) {
+    *value = ctx->value;
+  }
+
+  if (parent_idx != NULL) {
+    *parent_idx = ctx->parent;
+  }
+
+  return 0;
+}
+
+int conf_sql_lookup_ctx_child(int ctx_idx, int prev_idx) {
+  struct sqlconf_lookup_ctx *ctx, *prev;
+  int child_idx;
+
+  ctx = lookup_get_ctx(ctx_idx);
+  if (ctx == NULL) {
+    return -1;
+  }
+
+  if (prev_idx < 0) {
+    child_idx = ctx->first_child;
+
+  } else {
+    prev = lookup_get_ctx(prev_idx);
+    if (prev == NULL) {
+      return -1;
+    }
+
+    if (prev->parent != ctx_idx) {
+      errno = EINVAL;
+      return -1;
+    }
+
+    child_idx = prev->next_sibling;
+  }
+
+  if (child_idx < 0) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  return child_idx;
+}
+
+int conf_sql_lookup_conf(int ctx_idx, const char *name, int prev_idx) {
+  struct sqlconf_lookup_ctx *ctx;
+  struct sqlconf_lookup_conf *confs;
+  unsigned int i, end;
+
+  ctx = lookup_get_ctx(ctx_idx);
+  if (ctx == NULL) {
+    return -1;
+  }
+
+  end = ctx->conf_start + ctx->nconfs;
+
+  if (prev_idx < 0) {
+    i = ctx->conf_start;
+
+  } else {
+    if ((unsigned int) prev_idx < ctx->conf_start ||
+        (unsigned int) prev_idx >= end) {
+      errno = EINVAL;
+      return -1;
+    }
+
+    i = prev_idx + 1;
+  }
+
+  confs = lookup_current->confs->elts;
+  for (; i < end; i++) {
+    if (name == NULL ||
+        strcasecmp(confs[i].name, name) == 0) {
+      return (int) i;
+    }
+  }
+
+  errno = ENOENT;
+  return -1;
+}
+
+int conf_sql_lookup_conf_info(int conf_idx, const char **name,
+    unsigned int *argc, const char * const **argv) {
+  struct sqlconf_lookup_conf *conf, *confs;
+
+  if (lookup_current == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  if (conf_idx < 0 ||
+      (unsigned int) conf_idx >= lookup_current->confs->nelts) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  confs = lookup_current->confs->elts;
+  conf = &(confs[conf_idx]);
+
+  if (name != NULL) {
+    *name = conf->name;
+  }
+
+  if (argc != NULL) {
+    *argc = conf->argc;
+  }
+
+  if (argv != NULL) {
+    *argv = ((const char * const *) lookup_current->args->elts) +
+      conf->arg_start;
+  }
+
+  return 0;
+}
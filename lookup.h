@@ -0,0 +1,75 @@
+/*
+ * ProFTPD - mod_conf_sql configuration lookup API
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+#include "mod_conf_sql.h"
+
+#ifndef MOD_CONF_SQL_LOOKUP_H
+#define MOD_CONF_SQL_LOOKUP_H
+
+/* A compact copy of the contexts and directives read from the database,
+ * built as the configuration is read, and kept for querying at runtime via
+ * the conf_sql_lookup_*() functions.
+ */
+typedef struct sqlconf_lookup_st sqlconf_lookup_t;
+
+sqlconf_lookup_t *sqlconf_lookup_create(pool *p);
+
+/* Opens the given context, as a child of the currently open context; the
+ * first context opened is the root.
+ */
+int sqlconf_lookup_open_ctx(sqlconf_lookup_t *lookup, const char *type,
+  const char *value);
+int sqlconf_lookup_close_ctx(sqlconf_lookup_t *lookup);
+
+/* Adds the given directive, with its already split arguments, to the
+ * currently open context.  Directives may follow the context's children;
+ * sqlconf_lookup_finish() puts them back next to the context's others.
+ */
+int sqlconf_lookup_add_conf(sqlconf_lookup_t *lookup, const char *name,
+  unsigned int argc, char **argv);
+
+/* Adds the given directive, splitting its value into arguments the way the
+ * configuration parser does.
+ */
+int sqlconf_lookup_add_conf_text(sqlconf_lookup_t *lookup, const char *name,
+  const char *value);
+
+/* Orders the directives by context, and releases the bookkeeping needed
+ * only while building.
+ */
+int sqlconf_lookup_finish(sqlconf_lookup_t *lookup);
+
+void sqlconf_lookup_destroy(sqlconf_lookup_t *lookup);
+
+/* Makes the given lookup the one queried by the conf_sql_lookup_*()
+ * functions; the previously used lookup, if any, is destroyed.  A NULL
+ * lookup clears the current one.
+ */
+void sqlconf_lookup_use(sqlconf_lookup_t *lookup);
+
+/* Returns the number of bytes allocated for the lookup. */
+size_t sqlconf_lookup_get_size(sqlconf_lookup_t *lookup);
+
+#endif /* MOD_CONF_SQL_LOOKUP_H */
@@ -26,132 +26,210 @@
 #include "param.h"
 #include "uri.h"
 
-/* Expected format of the conf parameter:
+/* The ctx, conf, map, view, and doc parameters share one syntax:
  *
- *   conf=<table>[:id,name,value][:where=<clause>]
+ *   <name>=<table>[:<col>,<col>,...][:where=<clause>]
+ *
+ * with the columns given in the order of the table's spec.
  */
-int sqlconf_param_parse_conf(pool *p, pr_table_t *params, char **table,
-    char **id_col, char **name_col, char **value_col, char **where) {
-  const void *v, *val, *cols_val;
-  size_t sz, vsz, valsz, cols_valsz;
-  char *ptr;
+const struct sqlconf_param_spec sqlconf_param_ctx_spec = {
+  "ctx", CONF_SQL_CTX_DEFAULT_TABLE_NAME, 4, 4,
+  { CONF_SQL_CTX_DEFAULT_ID_COL_NAME,
+    CONF_SQL_CTX_DEFAULT_PARENT_ID_COL_NAME,
+    CONF_SQL_CTX_DEFAULT_TYPE_COL_NAME,
+    CONF_SQL_CTX_DEFAULT_VALUE_COL_NAME }
+};
+
+const struct sqlconf_param_spec sqlconf_param_conf_spec = {
+  "conf", CONF_SQL_CONF_DEFAULT_TABLE_NAME, 3, 3,
+  { CONF_SQL_CONF_DEFAULT_ID_COL_NAME,
+    CONF_SQL_CONF_DEFAULT_NAME_COL_NAME,
+    CONF_SQL_CONF_DEFAULT_VALUE_COL_NAME }
+};
+
+const struct sqlconf_param_spec sqlconf_param_map_spec = {
+  "map", CONF_SQL_MAP_DEFAULT_TABLE_NAME, 2, 2,
+  { CONF_SQL_MAP_DEFAULT_CONF_ID_COL_NAME,
+    CONF_SQL_MAP_DEFAULT_CTX_ID_COL_NAME }
+};
+
+const struct sqlconf_param_spec sqlconf_param_view_spec = {
+  "view", CONF_SQL_VIEW_DEFAULT_TABLE_NAME, 2, 2,
+  { CONF_SQL_VIEW_DEFAULT_SEQ_COL_NAME,
+    CONF_SQL_VIEW_DEFAULT_LINE_COL_NAME }
+};
+
+const struct sqlconf_param_spec sqlconf_param_doc_spec = {
+  "doc", CONF_SQL_DOC_DEFAULT_TABLE_NAME, 2, 2,
+  { CONF_SQL_DOC_DEFAULT_ID_COL_NAME,
+    CONF_SQL_DOC_DEFAULT_DOC_COL_NAME }
+};
+
+static int param_invalid(const struct sqlconf_param_spec *spec,
+    const char *val, size_t valsz, struct sqlconf_param_cols *cols,
+    const char *reason) {
+  pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+    ": badly formatted '%s' parameter '%.*s': %s", spec->name, (int) valsz,
+    val, reason);
+
+  memset(cols, 0, sizeof(struct sqlconf_param_cols));
+  errno = EINVAL;
+  return -1;
+}
+
+int sqlconf_param_parse_table(pool *p, pr_table_t *params,
+    const struct sqlconf_param_spec *spec, struct sqlconf_param_cols *cols) {
+  register unsigned int i;
+  const char *val, *ptr, *end, *col, *cols_end;
+  const void *v;
+  size_t vsz, valsz;
 
   if (p == NULL ||
       params == NULL ||
-      table == NULL ||
-      id_col == NULL ||
-      name_col == NULL ||
-      value_col == NULL ||
-      where == NULL) {
+      spec == NULL ||
+      cols == NULL) {
     errno = EINVAL;
     return -1;
   }
 
-  v = pr_table_get(params, "conf", &vsz);
+  memset(cols, 0, sizeof(struct sqlconf_param_cols));
+
+  v = pr_table_get(params, spec->name, &vsz);
   if (v == NULL) {
-    *table = *id_col = *name_col = *value_col = *where = NULL;
     return 0;
   }
 
-  /* Ignore empty values.  Remember that table value lengths include the NUL. */
-  if (vsz < 2) {
-    *table = *id_col = *name_col = *value_col = *where = NULL;
+  /* Table value lengths may or may not include the NUL, depending on how
+   * the value was added; use the length of the string itself.
+   */
+  val = v;
+  ptr = memchr(val, '\0', vsz);
+  valsz = (ptr != NULL ? (size_t) (ptr - val) : vsz);
+
+  /* Ignore empty values. */
+  if (valsz == 0) {
     return 0;
   }
 
-  val = v;
-  valsz = vsz-1;
+  end = val + valsz;
 
-  ptr = memchr(v, ':', vsz);
+  ptr = memchr(val, ':', valsz);
   if (ptr == NULL) {
     /* Just the table name, then. */
-    sz = vsz;
-    *table = pstrndup(p, v, sz);
-    *id_col = *name_col = *value_col = *where = NULL;
-
+    cols->table = pstrndup(p, val, valsz);
     return 0;
   }
 
-  sz = ptr - ((char *) v);
-  *table = pstrndup(p, v, sz);
+  cols->table = pstrndup(p, val, ptr - val);
+
+  /* The column names run up to the next ':', if any; there may be none,
+   * i.e. "<table>::where=...".
+   */
+  col = ptr + 1;
+  cols_end = memchr(col, ':', end - col);
+  if (cols_end == NULL) {
+    cols_end = end;
+  }
+
+  if (cols_end > col) {
+    for (i = 0; i < spec->ncols && col <= cols_end; i++) {
+      ptr = memchr(col, ',', cols_end - col);
+      if (ptr == NULL) {
+        ptr = cols_end;
+      }
 
-  *id_col = *name_col = *value_col = *where = NULL;
+      if (ptr == col) {
+        return param_invalid(spec, val, valsz, cols, "empty column name");
+      }
 
-  v = ptr + 1;
-  vsz = vsz - sz - 1;
-  ptr = memchr(v, ':', vsz);
-  if (ptr != NULL) {
-    cols_val = v;
-    cols_valsz = 0;
+      cols->cols[i] = pstrndup(p, col, ptr - col);
+      col = ptr + 1;
+    }
 
-    /* Handle the case where ptr is pointing AT v, i.e. v is pointing at
-     * ":...".
-     */
-    if (ptr != v) {
-      cols_valsz = ptr - (char *) v;
+    if (i < spec->nrequired) {
+      return param_invalid(spec, val, valsz, cols, "missing column names");
     }
 
-  } else {
-    cols_val = v;
-    cols_valsz = vsz;
+    if (col <= cols_end) {
+      return param_invalid(spec, val, valsz, cols, "too many column names");
+    }
   }
 
-  if (cols_valsz != 0) {
-    ptr = memchr(cols_val, ',', cols_valsz);
-    if (ptr == NULL) {
-      pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
-        ": badly formatted 'conf' parameter '%.*s': missing column names",
-        (int) valsz, (char *) val);
-      errno = EINVAL;
-      return -1;
+  if (cols_end < end) {
+    size_t wheresz = 0;
+
+    /* Possible WHERE clause included. */
+    ptr = cols_end + 1;
+    if ((size_t) (end - ptr) < 6 ||
+        strncasecmp(ptr, "where=", 6) != 0) {
+      return param_invalid(spec, val, valsz, cols, "bad WHERE clause");
     }
 
-    sz = ptr - (char *) cols_val;
-    *id_col = pstrndup(p, cols_val, sz);
-
-    cols_val = ptr + 1;
-    cols_valsz = cols_valsz - sz - 1;
-    ptr = memchr(cols_val, ',', cols_valsz);
-    if (ptr == NULL) {
-      pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
-        ": badly formatted 'conf' parameter '%.*s': missing column names",
-        (int) valsz, (char *) val);
-      errno = EINVAL;
-      return -1;
+    /* Only the clause itself is kept; the query builders add the keyword. */
+    ptr += 6;
+    if (ptr == end) {
+      return param_invalid(spec, val, valsz, cols, "empty WHERE clause");
     }
 
-    sz = ptr - (char *) cols_val;
-    *name_col = pstrndup(p, cols_val, sz);
+    if (sqlconf_uri_urldecode(p, ptr, end - ptr, &(cols->where),
+        &wheresz) < 0) {
+      return -1;
+    }
+  }
 
-    cols_val = ptr + 1;
-    cols_valsz = cols_valsz - sz - 1;
-    ptr = memchr(cols_val, ':', cols_valsz);
-    if (ptr == NULL) {
-      *value_col = pstrndup(p, cols_val, cols_valsz);
+  return 0;
+}
 
-    } else {
-      *value_col = pstrndup(p, cols_val, sz);
-    }
+void sqlconf_param_set_defaults(const struct sqlconf_param_spec *spec,
+    struct sqlconf_param_cols *cols) {
+  register unsigned int i;
 
-    ptr = memchr((char *) v + cols_valsz, ':', vsz - cols_valsz);
+  if (spec == NULL ||
+      cols == NULL) {
+    return;
   }
 
-  if (ptr != NULL) {
-    size_t wheresz = 0;
+  if (cols->table == NULL) {
+    cols->table = (char *) spec->table;
+  }
 
-    /* Possible WHERE clause included. */
-    if (strncasecmp(ptr+1, "where=", 6) != 0) {
-      pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
-        ": badly formatted 'conf' parameter '%.*s': bad WHERE clause",
-        (int) valsz, (char *) val);
-      errno = EINVAL;
-      return -1;
+  for (i = 0; i < spec->ncols; i++) {
+    if (cols->cols[i] == NULL) {
+      cols->cols[i] = (char *) spec->cols[i];
     }
+  }
+}
+
+/* Expected format of the conf parameter:
+ *
+ *   conf=<table>[:id,name,value][:where=<clause>]
+ */
+int sqlconf_param_parse_conf(pool *p, pr_table_t *params, char **table,
+    char **id_col, char **name_col, char **value_col, char **where) {
+  struct sqlconf_param_cols cols;
+
+  if (p == NULL ||
+      params == NULL ||
+      table == NULL ||
+      id_col == NULL ||
+      name_col == NULL ||
+      value_col == NULL ||
+      where == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
 
-    sz = strlen(ptr+1);
-    sqlconf_uri_urldecode(p, ptr+1, sz, where, &wheresz);
+  if (sqlconf_param_parse_table(p, params, &sqlconf_param_conf_spec,
+      &cols) < 0) {
+    return -1;
   }
 
+  *table = cols.table;
+  *id_col = cols.cols[CONF_SQL_CONF_COL_ID];
+  *name_col = cols.cols[CONF_SQL_CONF_COL_NAME];
+  *value_col = cols.cols[CONF_SQL_CONF_COL_VALUE];
+  *where = cols.where;
+
   return 0;
 }
 
@@ -162,9 +240,7 @@ int sqlconf_param_parse_conf(pool *p, pr_table_t *params, char **table,
 int sqlconf_param_parse_ctx(pool *p, pr_table_t *params, char **table,
     char **id_col, char **parent_id_col, char **type_col, char **value_col,
     char **where) {
-  const void *v, *val, *cols_val;
-  size_t sz, vsz, valsz, cols_valsz;
-  char *ptr;
+  struct sqlconf_param_cols cols;
 
   if (p == NULL ||
       params == NULL ||
@@ -178,124 +254,17 @@ int sqlconf_param_parse_ctx(pool *p, pr_table_t *params, char **table,
     return -1;
   }
 
-  v = pr_table_get(params, "ctx", &vsz);
-  if (v == NULL) {
-    *table = *id_col = *parent_id_col = *type_col = *value_col = *where = NULL;
-    return 0;
-  }
-
-  /* Ignore empty values.  Remember that table value lengths include the NUL. */
-  if (vsz < 2) {
-    *table = *id_col = *parent_id_col = *type_col = *value_col = *where = NULL;
-    return 0;
-  }
-
-  val = v;
-  valsz = vsz-1;
-
-  ptr = memchr(v, ':', vsz);
-  if (ptr == NULL) {
-    /* Just the table name, then. */
-    sz = vsz;
-    *table = pstrndup(p, v, sz);
-    *id_col = *parent_id_col = *type_col = *value_col = *where = NULL;
-
-    return 0;
-  }
-
-  sz = ptr - ((char *) v);
-  *table = pstrndup(p, v, sz);
-
-  *id_col = *parent_id_col = *type_col = *value_col = *where = NULL;
-
-  v = ptr + 1;
-  vsz = vsz - sz - 1;
-  ptr = memchr(v, ':', vsz);
-  if (ptr != NULL) {
-    cols_val = v;
-    cols_valsz = 0;
-
-    /* Handle the case where ptr is pointing AT v, i.e. v is pointing at
-     * ":...".
-     */
-    if (ptr != v) {
-      cols_valsz = ptr - (char *) v;
-    }
-
-  } else {
-    cols_val = v;
-    cols_valsz = vsz;
-  }
-
-  if (cols_valsz != 0) {
-    ptr = memchr(cols_val, ',', cols_valsz);
-    if (ptr == NULL) {
-      pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
-        ": badly formatted 'ctx' parameter '%.*s': missing column names",
-        (int) valsz, (char *) val);
-      errno = EINVAL;
-      return -1;
-    }
-
-    sz = ptr - (char *) cols_val;
-    *id_col = pstrndup(p, cols_val, sz);
-
-    cols_val = ptr + 1;
-    cols_valsz = cols_valsz - sz - 1;
-    ptr = memchr(cols_val, ',', cols_valsz);
-    if (ptr == NULL) {
-      pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
-        ": badly formatted 'ctx' parameter '%.*s': missing column names",
-        (int) valsz, (char *) val);
-      errno = EINVAL;
-      return -1;
-    }
-
-    sz = ptr - (char *) cols_val;
-    *parent_id_col = pstrndup(p, cols_val, sz);
-
-    cols_val = ptr + 1;
-    cols_valsz = cols_valsz - sz - 1;
-    ptr = memchr(cols_val, ',', cols_valsz);
-    if (ptr == NULL) {
-      pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
-        ": badly formatted 'ctx' parameter '%.*s': missing column names",
-        (int) valsz, (char *) val);
-      errno = EINVAL;
-      return -1;
-    }
-
-    sz = ptr - (char *) cols_val;
-    *type_col = pstrndup(p, cols_val, sz);
-
-    cols_val = ptr + 1;
-    cols_valsz = cols_valsz - sz - 1;
-    ptr = memchr(cols_val, ':', cols_valsz);
-    if (ptr == NULL) {
-      *value_col = pstrndup(p, cols_val, cols_valsz);
-
-    } else {
-      *value_col = pstrndup(p, cols_val, sz);
-    }
-
-    ptr = memchr((char *) v + cols_valsz, ':', vsz - cols_valsz);
+  if (sqlconf_param_parse_table(p, params, &sqlconf_param_ctx_spec,
+      &cols) < 0) {
+    return -1;
   }
 
-  if (ptr != NULL) {
-    size_t wheresz = 0;
-
-    /* Possible WHERE clause included. */
-    if (strncasecmp(ptr+1, "where=", 6) != 0) {
-      pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
-        ": badly formatted 'ctx' parameter '%.*s': bad WHERE clause",
-        (int) valsz, (char *) val);
-      errno = EINVAL;
-      return -1;
-    }
-
-    sz = strlen(ptr+1);
-    sqlconf_uri_urldecode(p, ptr+1, sz, where, &wheresz);
-  }
+  *table = cols.table;
+  *id_col = cols.cols[CONF_SQL_CTX_COL_ID];
+  *parent_id_col = cols.cols[CONF_SQL_CTX_COL_PARENT_ID];
+  *type_col = cols.cols[CONF_SQL_CTX_COL_TYPE];
+  *value_col = cols.cols[CONF_SQL_CTX_COL_VALUE];
+  *where = cols.where;
 
   return 0;
 }
@@ -306,9 +275,7 @@ int sqlconf_param_parse_ctx(pool *p, pr_table_t *params, char **table,
  */
 int sqlconf_param_parse_map(pool *p, pr_table_t *params, char **table,
     char **conf_id_col, char **ctx_id_col, char **where) {
-  const void *v, *val, *cols_val;
-  size_t sz, vsz, valsz, cols_valsz;
-  char *ptr;
+  struct sqlconf_param_cols cols;
 
   if (p == NULL ||
       params == NULL ||
@@ -320,95 +287,88 @@ int sqlconf_param_parse_map(pool *p, pr_table_t *params, char **table,
     return -1;
   }
 
-  v = pr_table_get(params, "map", &vsz);
-  if (v == NULL) {
-    *table = *conf_id_col = *ctx_id_col = *where = NULL;
-    return 0;
+  if (sqlconf_param_parse_table(p, params, &sqlconf_param_map_spec,
+      &cols) < 0) {
+    return -1;
   }
 
-  /* Ignore empty values.  Remember that table value lengths include the NUL. */
-  if (vsz < 2) {
-    *table = *conf_id_col = *ctx_id_col = *where = NULL;
-    return 0;
-  }
+  *table = cols.table;
+  *conf_id_col = cols.cols[CONF_SQL_MAP_COL_CONF_ID];
+  *ctx_id_col = cols.cols[CONF_SQL_MAP_COL_CTX_ID];
+  *where = cols.where;
 
-  val = v;
-  valsz = vsz-1;
+  return 0;
+}
 
-  ptr = memchr(v, ':', vsz);
-  if (ptr == NULL) {
-    /* Just the table name, then. */
-    sz = vsz-1;
-    *table = pstrndup(p, v, sz);
-    *conf_id_col = *ctx_id_col = *where = NULL;
+/* Expected format of the argv parameter:
+ *
+ *   argv=<column>[:<separator>]
+ */
+int sqlconf_param_parse_argv(pool *p, pr_table_t *params, char **argv_col,
+    char **separator) {
+  const void *v;
+  const char *val, *end, *ptr;
+  size_t sz, vsz, valsz;
 
-    return 0;
+  if (p == NULL ||
+      params == NULL ||
+      argv_col == NULL ||
+      separator == NULL) {
+    errno = EINVAL;
+    return -1;
   }
 
-  sz = ptr - ((char *) v);
-  *table = pstrndup(p, v, sz);
-
-  *conf_id_col = *ctx_id_col = *where = NULL;
+  *argv_col = *separator = NULL;
 
-  v = ptr + 1;
-  vsz = vsz - sz - 1;
-  ptr = memchr(v, ':', vsz);
-  if (ptr != NULL) {
-    cols_val = v;
-    cols_valsz = 0;
-
-    /* Handle the case where ptr is pointing AT v, i.e. v is pointing at
-     * ":...".
-     */
-    if (ptr != v) {
-      cols_valsz = ptr - (char *) v;
-    }
-
-  } else {
-    cols_val = v;
-    cols_valsz = vsz;
+  v = pr_table_get(params, "argv", &vsz);
+  if (v == NULL) {
+    return 0;
   }
 
-  if (cols_valsz != 0) {
-    ptr = memchr(cols_val, ',', cols_valsz);
-    if (ptr == NULL) {
-      pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
-        ": badly formatted 'map' parameter '%.*s': missing column names",
-        (int) valsz, (char *) val);
-      errno = EINVAL;
-      return -1;
-    }
+  /* Table value lengths may or may not include the NUL, depending on how
+   * the value was added; use the length of the string itself.
+   */
+  val = v;
+  ptr = memchr(val, '\0', vsz);
+  valsz = (ptr != NULL ? (size_t) (ptr - val) : vsz);
 
-    sz = ptr - (char *) cols_val;
-    *conf_id_col = pstrndup(p, cols_val, sz);
+  /* Ignore empty values. */
+  if (valsz == 0) {
+    return 0;
+  }
 
-    cols_val = ptr + 1;
-    cols_valsz = cols_valsz - sz - 1;
-    ptr = memchr(cols_val, ':', cols_valsz);
-    if (ptr == NULL) {
-      *ctx_id_col = pstrndup(p, cols_val, cols_valsz);
+  end = val + valsz;
 
-    } else {
-      *ctx_id_col = pstrndup(p, cols_val, sz);
-    }
+  ptr = memchr(val, ':', valsz);
+  if (ptr == NULL) {
+    /* Just the column name, then. */
+    *argv_col = pstrndup(p, val, valsz);
+    return 0;
+  }
 
-    ptr = memchr((char *) v + cols_valsz, ':', vsz - cols_valsz);
+  sz = ptr - val;
+  if (sz == 0) {
+    pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+      ": badly formatted 'argv' parameter '%.*s': missing column name",
+      (int) valsz, val);
+    errno = EINVAL;
+    return -1;
   }
 
-  if (ptr != NULL) {
-    size_t wheresz = 0;
+  *argv_col = pstrndup(p, val, sz);
 
-    /* Possible WHERE clause included. */
-    if (strncasecmp(ptr+1, "where=", 6) != 0) {
-      pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
-        ": badly formatted 'map' parameter '%.*s': bad WHERE clause",
-        (int) valsz, (char *) val);
-      errno = EINVAL;
-      return -1;
-    }
+  if (sqlconf_uri_urldecode(p, ptr+1, end - (ptr+1), separator, &sz) < 0) {
+    *argv_col = NULL;
+    return -1;
+  }
 
-    sz = strlen(ptr+1);
-    sqlconf_uri_urldecode(p, ptr+1, sz, where, &wheresz);
+  if (sz != 1) {
+    pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+      ": badly formatted 'argv' parameter '%.*s': separator must be a single "
+      "character", (int) valsz, val);
+    *argv_col = *separator = NULL;
+    errno = EINVAL;
+    return -1;
   }
 
   return 0;
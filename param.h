@@ -27,6 +27,64 @@
 #ifndef MOD_CONF_SQL_PARAM_H
 #define MOD_CONF_SQL_PARAM_H
 
+/* The parameters naming the configuration tables share one syntax:
+ *
+ *   <name>=<table>[:<col>,<col>,...][:where=<clause>]
+ *
+ * with the columns given in the order set by the table's spec.  The first
+ * nrequired columns must be given, if any are; the rest are optional.
+ */
+#define CONF_SQL_PARAM_MAX_COLS		8
+
+struct sqlconf_param_spec {
+  const char *name;
+
+  /* The default table and column names. */
+  const char *table;
+  unsigned int ncols;
+  unsigned int nrequired;
+  const char *cols[CONF_SQL_PARAM_MAX_COLS];
+};
+
+/* The table, column, and WHERE clause parsed from a parameter; any not
+ * given are NULL.
+ */
+struct sqlconf_param_cols {
+  char *table;
+  char *cols[CONF_SQL_PARAM_MAX_COLS];
+  char *where;
+};
+
+extern const struct sqlconf_param_spec sqlconf_param_ctx_spec;
+#define CONF_SQL_CTX_COL_ID			0
+#define CONF_SQL_CTX_COL_PARENT_ID		1
+#define CONF_SQL_CTX_COL_TYPE			2
+#define CONF_SQL_CTX_COL_VALUE			3
+
+extern const struct sqlconf_param_spec sqlconf_param_conf_spec;
+#define CONF_SQL_CONF_COL_ID			0
+#define CONF_SQL_CONF_COL_NAME			1
+#define CONF_SQL_CONF_COL_VALUE			2
+
+extern const struct sqlconf_param_spec sqlconf_param_map_spec;
+#define CONF_SQL_MAP_COL_CONF_ID		0
+#define CONF_SQL_MAP_COL_CTX_ID			1
+
+extern const struct sqlconf_param_spec sqlconf_param_view_spec;
+#define CONF_SQL_VIEW_COL_SEQ			0
+#define CONF_SQL_VIEW_COL_LINE			1
+
+extern const struct sqlconf_param_spec sqlconf_param_doc_spec;
+#define CONF_SQL_DOC_COL_ID			0
+#define CONF_SQL_DOC_COL_DOC			1
+
+int sqlconf_param_parse_table(pool *p, pr_table_t *params,
+  const struct sqlconf_param_spec *spec, struct sqlconf_param_cols *cols);
+
+/* Fills in the default names from the spec, for any not given. */
+void sqlconf_param_set_defaults(const struct sqlconf_param_spec *spec,
+  struct sqlconf_param_cols *cols);
+
 /* Expected format of the conf parameter:
  *
  *   conf=<table>[:id,name,value][:where=<clause>]
@@ -61,4 +119,31 @@ int sqlconf_param_parse_map(pool *p, pr_table_t *params, char **table,
 #define CONF_SQL_MAP_DEFAULT_CONF_ID_COL_NAME		"conf_id"
 #define CONF_SQL_MAP_DEFAULT_CTX_ID_COL_NAME		"ctx_id"
 
+/* Expected format of the view parameter, naming a view (or set-returning
+ * function) of configuration lines rendered by the database:
+ *
+ *   view=<view>[:seq,line][:where=<clause>]
+ */
+#define CONF_SQL_VIEW_DEFAULT_TABLE_NAME		"ftpconf_lines"
+#define CONF_SQL_VIEW_DEFAULT_SEQ_COL_NAME		"seq"
+#define CONF_SQL_VIEW_DEFAULT_LINE_COL_NAME		"line"
+
+/* Expected format of the doc parameter, naming a table of JSON configuration
+ * documents:
+ *
+ *   doc=<table>[:id,doc][:where=<clause>]
+ */
+#define CONF_SQL_DOC_DEFAULT_TABLE_NAME			"ftpdoc"
+#define CONF_SQL_DOC_DEFAULT_ID_COL_NAME		"id"
+#define CONF_SQL_DOC_DEFAULT_DOC_COL_NAME		"doc"
+
+/* Expected format of the argv parameter:
+ *
+ *   argv=<column>[:<separator>]
+ *
+ * If no separator is given, the column values are JSON arrays.
+ */
+int sqlconf_param_parse_argv(pool *p, pr_table_t *params, char **argv_col,
+  char **separator);
+
 #endif /* MOD_CONF_SQL_PARAM_H */
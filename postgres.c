@@ -0,0 +1,473 @@
+/*
+ * ProFTPD - mod_conf_sql PostgreSQL implementation
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+#include "postgres.h"
+#include "tree.h"
+
+#ifdef CONF_SQL_USE_LIBPQ
+#include <libpq-fe.h>
+
+static PGconn *postgres_conn = NULL;
+static int postgres_prepared[CONF_SQL_QUERY_MAX+1];
+
+/* The maximum number of statements sent in a pipeline before reading their
+ * results.  Bounding this keeps us from filling the socket buffers in both
+ * directions, at which point neither side can make progress.
+ */
+#define CONF_SQL_POSTGRES_PIPELINE_MAX		128
+
+static const char *trace_channel = "conf_sql";
+
+int sqlconf_postgres_open(pool *p, const char *server, const char *username,
+    const char *password, const char *database) {
+  const char *keys[6], *values[6];
+  char *host, *port = NULL;
+  unsigned int i = 0;
+
+  if (p == NULL ||
+      server == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (postgres_conn != NULL) {
+    (void) sqlconf_postgres_close();
+  }
+
+  memset(postgres_prepared, 0, sizeof(postgres_prepared));
+
+  /* Unix domain socket directories are given as paths, and cannot include
+   * a port.
+   */
+  host = pstrdup(p, server);
+  if (*host != '/') {
+    port = strrchr(host, ':');
+    if (port != NULL) {
+      *port++ = '\0';
+    }
+  }
+
+  keys[i] = "host";
+  values[i++] = host;
+
+  if (port != NULL) {
+    keys[i] = "port";
+    values[i++] = port;
+  }
+
+  if (username != NULL) {
+    keys[i] = "user";
+    values[i++] = username;
+  }
+
+  if (password != NULL) {
+    keys[i] = "password";
+    values[i++] = password;
+  }
+
+  if (database != NULL) {
+    keys[i] = "dbname";
+    values[i++] = database;
+  }
+
+  keys[i] = values[i] = NULL;
+
+  pr_trace_msg(trace_channel, 9, "connecting to PostgreSQL server '%s'",
+    server);
+
+  postgres_conn = PQconnectdbParams(keys, values, 0);
+  if (postgres_conn == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  if (PQstatus(postgres_conn) != CONNECTION_OK) {
+    pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+      ": error connecting to PostgreSQL server '%s': %s", server,
+      PQerrorMessage(postgres_conn));
+
+    PQfinish(postgres_conn);
+    postgres_conn = NULL;
+    errno = EPERM;
+    return -1;
+  }
+
+  return 0;
+}
+
+int sqlconf_postgres_close(void) {
+  if (postgres_conn != NULL) {
+    PQfinish(postgres_conn);
+    postgres_conn = NULL;
+  }
+
+  return 0;
+}
+
+int sqlconf_postgres_copy(pool *p, const char *query, unsigned int nfields,
+    int (*row_cb)(char **fields, void *user_data), void *user_data) {
+  int res, xerrno = 0;
+  char *sql, **fields, *row = NULL;
+  PGresult *pg_res;
+  unsigned long nrows = 0;
+
+  if (p == NULL ||
+      query == NULL ||
+      nfields == 0 ||
+      row_cb == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (postgres_conn == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  sql = pstrcat(p, "COPY (SELECT ", query, ") TO STDOUT", NULL);
+  pr_trace_msg(trace_channel, 9, "executing PostgreSQL '%s'", sql);
+
+  pg_res = PQexec(postgres_conn, sql);
+  if (PQresultStatus(pg_res) != PGRES_COPY_OUT) {
+    pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+      ": error executing PostgreSQL '%s': %s", sql,
+      PQerrorMessage(postgres_conn));
+    PQclear(pg_res);
+    errno = EINVAL;
+    return -1;
+  }
+
+  PQclear(pg_res);
+  fields = pcalloc(p, sizeof(char *) * nfields);
+
+  /* Each row arrives as a single NUL-terminated line; we need to consume
+   * the entire stream, even after an error, before the connection can be
+   * used again.
+   */
+  res = PQgetCopyData(postgres_conn, &row, 0);
+  while (res > 0) {
+    pr_signals_handle();
+
+    if (xerrno == 0) {
+      if (sqlconf_tree_split_copy_row(row, (size_t) res, fields,
+          nfields) < 0) {
+        xerrno = errno;
+        pr_trace_msg(trace_channel, 3, "error parsing row %lu: %s",
+          nrows + 1, strerror(xerrno));
+
+      } else if ((row_cb)(fields, user_data) < 0) {
+        xerrno = errno;
+      }
+    }
+
+    PQfreemem(row);
+    row = NULL;
+    nrows++;
+
+    res = PQgetCopyData(postgres_conn, &row, 0);
+  }
+
+  if (res == -2) {
+    pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+      ": error reading PostgreSQL COPY data: %s",
+      PQerrorMessage(postgres_conn));
+    xerrno = EIO;
+  }
+
+  /* Collect the final status of the COPY command. */
+  pg_res = PQgetResult(postgres_conn);
+  while (pg_res != NULL) {
+    if (PQresultStatus(pg_res) != PGRES_COMMAND_OK &&
+        xerrno == 0) {
+      pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+        ": error completing PostgreSQL COPY: %s",
+        PQresultErrorMessage(pg_res));
+      xerrno = EIO;
+    }
+
+    PQclear(pg_res);
+    pg_res = PQgetResult(postgres_conn);
+  }
+
+  pr_trace_msg(trace_channel, 9, "read %lu %s via COPY", nrows,
+    nrows != 1 ? "rows" : "row");
+
+  if (xerrno != 0) {
+    errno = xerrno;
+    return -1;
+  }
+
+  return 0;
+}
+
+static void postgres_stmt_name(unsigned int shape, char *name, size_t namesz) {
+  memset(name, '\0', namesz);
+  snprintf(name, namesz-1, "sqlconf_%u", shape);
+}
+
+int sqlconf_postgres_prepare(pool *p, unsigned int shape, const char *query) {
+  char *sql, name[32];
+  PGresult *pg_res;
+
+  if (p == NULL ||
+      shape > CONF_SQL_QUERY_MAX ||
+      query == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (postgres_conn == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  postgres_stmt_name(shape, name, sizeof(name));
+  sql = pstrcat(p, "SELECT ", query, NULL);
+
+  pr_trace_msg(trace_channel, 9, "preparing PostgreSQL statement '%s'", sql);
+
+  pg_res = PQprepare(postgres_conn, name, sql, 0, NULL);
+  if (PQresultStatus(pg_res) != PGRES_COMMAND_OK) {
+    pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+      ": error preparing PostgreSQL statement '%s': %s", sql,
+      PQerrorMessage(postgres_conn));
+    PQclear(pg_res);
+    errno = EINVAL;
+    return -1;
+  }
+
+  PQclear(pg_res);
+  postgres_prepared[shape] = TRUE;
+  return 0;
+}
+
+/* Collect the given result rows in the same form as mod_sql. */
+static int postgres_get_data(pool *p, PGresult *pg_res, sql_data_t **sd) {
+  register int i, j;
+  int nrows, ncols;
+  char **data;
+
+  if (PQresultStatus(pg_res) != PGRES_TUPLES_OK) {
+    pr_trace_msg(trace_channel, 9, "PostgreSQL SELECT error: %s",
+      PQresultErrorMessage(pg_res));
+    errno = EIO;
+    return -1;
+  }
+
+  nrows = PQntuples(pg_res);
+  ncols = PQnfields(pg_res);
+
+  data = pcalloc(p, sizeof(char *) * ((nrows * ncols) + 1));
+  for (i = 0; i < nrows; i++) {
+    for (j = 0; j < ncols; j++) {
+      /* NULL values are kept as NULL, as for COPY rows, so that malformed
+       * rows are skipped the same way.
+       */
+      if (PQgetisnull(pg_res, i, j)) {
+        continue;
+      }
+
+      data[(i * ncols) + j] = pstrndup(p, PQgetvalue(pg_res, i, j),
+        PQgetlength(pg_res, i, j));
+    }
+  }
+
+  *sd = pcalloc(p, sizeof(sql_data_t));
+  (*sd)->rnum = nrows;
+  (*sd)->fnum = ncols;
+  (*sd)->data = data;
+
+  return 0;
+}
+
+#ifdef LIBPQ_HAS_PIPELINING
+static int postgres_select_pipeline(pool *p, unsigned int nqueries,
+    const unsigned int *shapes, const int *ctx_ids, sql_data_t **results) {
+  register unsigned int i;
+  int xerrno = 0;
+  PGresult *pg_res;
+
+  if (PQenterPipelineMode(postgres_conn) != 1) {
+    pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+      ": error entering PostgreSQL pipeline mode: %s",
+      PQerrorMessage(postgres_conn));
+    errno = EIO;
+    return -1;
+  }
+
+  for (i = 0; i < nqueries; i++) {
+    char name[32], idstr[32];
+    const char *param;
+
+    postgres_stmt_name(shapes[i], name, sizeof(name));
+
+    memset(idstr, '\0', sizeof(idstr));
+    snprintf(idstr, sizeof(idstr)-1, "%d", ctx_ids[i]);
+    param = idstr;
+
+    if (PQsendQueryPrepared(postgres_conn, name,
+        shapes[i] != CONF_SQL_QUERY_BASE_CTX ? 1 : 0, &param, NULL, NULL,
+        0) != 1) {
+      pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+        ": error sending PostgreSQL statement: %s",
+        PQerrorMessage(postgres_conn));
+      xerrno = EIO;
+      break;
+    }
+  }
+
+  if (PQpipelineSync(postgres_conn) != 1) {
+    pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+      ": error syncing PostgreSQL pipeline: %s",
+      PQerrorMessage(postgres_conn));
+    (void) PQexitPipelineMode(postgres_conn);
+    errno = EIO;
+    return -1;
+  }
+
+  /* The results arrive in the order in which the statements were sent; each
+   * is followed by a NULL, and the whole pipeline by the sync result.
+   */
+  for (i = 0; i < nqueries; i++) {
+    pg_res = PQgetResult(postgres_conn);
+    if (pg_res == NULL) {
+      /* Statements which failed to be sent have no results. */
+      break;
+    }
+
+    if (xerrno == 0 &&
+        postgres_get_data(p, pg_res, &(results[i])) < 0) {
+      xerrno = errno;
+    }
+
+    PQclear(pg_res);
+
+    pg_res = PQgetResult(postgres_conn);
+    while (pg_res != NULL) {
+      PQclear(pg_res);
+      pg_res = PQgetResult(postgres_conn);
+    }
+  }
+
+  pg_res = PQgetResult(postgres_conn);
+  while (pg_res != NULL) {
+    ExecStatusType status;
+
+    status = PQresultStatus(pg_res);
+    PQclear(pg_res);
+
+    if (status == PGRES_PIPELINE_SYNC) {
+      break;
+    }
+
+    pg_res = PQgetResult(postgres_conn);
+  }
+
+  (void) PQexitPipelineMode(postgres_conn);
+
+  if (xerrno != 0) {
+    errno = xerrno;
+    return -1;
+  }
+
+  return 0;
+}
+#endif /* LIBPQ_HAS_PIPELINING */
+
+int sqlconf_postgres_select(pool *p, unsigned int nqueries,
+    const unsigned int *shapes, const int *ctx_ids, sql_data_t **results) {
+  register unsigned int i;
+
+  if (p == NULL ||
+      shapes == NULL ||
+      ctx_ids == NULL ||
+      results == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (postgres_conn == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  for (i = 0; i < nqueries; i++) {
+    if (shapes[i] > CONF_SQL_QUERY_MAX ||
+        postgres_prepared[shapes[i]] == FALSE) {
+      errno = EINVAL;
+      return -1;
+    }
+  }
+
+  pr_trace_msg(trace_channel, 12, "executing %u PostgreSQL %s", nqueries,
+    nqueries != 1 ? "statements" : "statement");
+
+#ifdef LIBPQ_HAS_PIPELINING
+  for (i = 0; i < nqueries; i += CONF_SQL_POSTGRES_PIPELINE_MAX) {
+    unsigned int count;
+
+    pr_signals_handle();
+
+    count = nqueries - i;
+    if (count > CONF_SQL_POSTGRES_PIPELINE_MAX) {
+      count = CONF_SQL_POSTGRES_PIPELINE_MAX;
+    }
+
+    if (postgres_select_pipeline(p, count, shapes + i, ctx_ids + i,
+        results + i) < 0) {
+      return -1;
+    }
+  }
+#else
+  /* Without pipelining, each statement costs a round trip. */
+  for (i = 0; i < nqueries; i++) {
+    char name[32], idstr[32];
+    const char *param;
+    PGresult *pg_res;
+    int res;
+
+    pr_signals_handle();
+
+    postgres_stmt_name(shapes[i], name, sizeof(name));
+
+    memset(idstr, '\0', sizeof(idstr));
+    snprintf(idstr, sizeof(idstr)-1, "%d", ctx_ids[i]);
+    param = idstr;
+
+    pg_res = PQexecPrepared(postgres_conn, name,
+      shapes[i] != CONF_SQL_QUERY_BASE_CTX ? 1 : 0, &param, NULL, NULL, 0);
+    res = postgres_get_data(p, pg_res, &(results[i]));
+    PQclear(pg_res);
+
+    if (res < 0) {
+      return -1;
+    }
+  }
+#endif /* LIBPQ_HAS_PIPELINING */
+
+  return 0;
+}
+
+#endif /* CONF_SQL_USE_LIBPQ */
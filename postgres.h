@@ -0,0 +1,63 @@
+/*
+ * ProFTPD - mod_conf_sql PostgreSQL API
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+#include "mod_sql.h"
+
+#ifndef MOD_CONF_SQL_POSTGRES_H
+#define MOD_CONF_SQL_POSTGRES_H
+
+#ifdef CONF_SQL_USE_LIBPQ
+
+/* Connects to the given PostgreSQL server, which may include a port, e.g.
+ * "dbhost:5432".
+ */
+int sqlconf_postgres_open(pool *p, const char *server, const char *username,
+  const char *password, const char *database);
+
+int sqlconf_postgres_close(void);
+
+/* Streams the results of the given query, sans the leading "SELECT", using
+ * COPY ... TO STDOUT, calling the given callback for each row.  Each row is
+ * split into the given number of fields; NULL values are passed as NULL.
+ */
+int sqlconf_postgres_copy(pool *p, const char *query, unsigned int nfields,
+  int (*row_cb)(char **fields, void *user_data), void *user_data);
+
+/* Prepares the statement for the given query shape.  The query text omits
+ * the leading "SELECT", and uses a "$1" placeholder for the context ID.
+ */
+int sqlconf_postgres_prepare(pool *p, unsigned int shape, const char *query);
+
+/* Executes the prepared statements for the given query shapes and context
+ * IDs, collecting each result in the same form as mod_sql.  When supported
+ * by libpq, all of the statements are sent, in a pipeline, before any of the
+ * results are read.
+ */
+int sqlconf_postgres_select(pool *p, unsigned int nqueries,
+  const unsigned int *shapes, const int *ctx_ids, sql_data_t **results);
+
+#endif /* CONF_SQL_USE_LIBPQ */
+
+#endif /* MOD_CONF_SQL_POSTGRES_H */
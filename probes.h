@@ -0,0 +1,51 @@
+/*
+ * ProFTPD - mod_conf_sql static tracing probes
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+
+#ifndef MOD_CONF_SQL_PROBES_H
+#define MOD_CONF_SQL_PROBES_H
+
+/* Static tracing probes, for attaching to with e.g. bpftrace, perf, or
+ * SystemTap, using the "conf_sql" provider.  When the probes are not
+ * available, they compile to nothing; when they are, an unattached probe
+ * costs a single no-op instruction.
+ */
+#ifdef HAVE_SDT
+# include <sys/sdt.h>
+
+# define CONF_SQL_PROBE1(name, a) \
+  DTRACE_PROBE1(conf_sql, name, a)
+# define CONF_SQL_PROBE2(name, a, b) \
+  DTRACE_PROBE2(conf_sql, name, a, b)
+# define CONF_SQL_PROBE3(name, a, b, c) \
+  DTRACE_PROBE3(conf_sql, name, a, b, c)
+
+#else
+# define CONF_SQL_PROBE1(name, a)
+# define CONF_SQL_PROBE2(name, a, b)
+# define CONF_SQL_PROBE3(name, a, b, c)
+#endif /* HAVE_SDT */
+
+#endif /* MOD_CONF_SQL_PROBES_H */
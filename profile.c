@@ -0,0 +1,319 @@
+/*
+ * ProFTPD - mod_conf_sql load profiling implementation
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+#include "mod_conf_sql.h"
+#include "profile.h"
+#include "stats.h"
+
+struct sqlconf_profile_entry {
+  const char *path;
+
+  uint64_t nsecs;
+  uint64_t queries;
+  uint64_t rows;
+};
+
+struct sqlconf_profile_frame {
+  /* NULL until the frame name is known. */
+  const char *path;
+
+  /* The position of the entry for this path. */
+  unsigned int entry_idx;
+
+  uint64_t nsecs;
+  uint64_t queries;
+  uint64_t rows;
+};
+
+static pool *profile_pool = NULL;
+
+/* Entries, in the order first entered, and keyed by path; contexts with
+ * the same path share an entry.
+ */
+static array_header *profile_entries = NULL;
+static pr_table_t *profile_index = NULL;
+
+static array_header *profile_stack = NULL;
+
+/* The hash chain count for the entries index; configurations with many
+ * thousands of contexts are expected.
+ */
+#define CONF_SQL_PROFILE_NCHAINS	1024
+
+/* When the current frame was last charged for its time. */
+static uint64_t profile_mark_ns = 0;
+
+static const char *trace_channel = "conf_sql";
+
+int sqlconf_profile_start(pool *p) {
+  int max_ents = INT_MAX;
+
+  if (p == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  profile_pool = make_sub_pool(p);
+  pr_pool_tag(profile_pool, "SQL Configuration Profile Pool");
+
+  profile_entries = make_array(profile_pool, 16,
+    sizeof(struct sqlconf_profile_entry));
+  profile_index = pr_table_nalloc(profile_pool, 0, CONF_SQL_PROFILE_NCHAINS);
+  (void) pr_table_ctl(profile_index, PR_TABLE_CTL_SET_MAX_ENTS, &max_ents);
+  profile_stack = make_array(profile_pool, 8,
+    sizeof(struct sqlconf_profile_frame));
+  profile_mark_ns = sqlconf_stats_now();
+
+  return 0;
+}
+
+void sqlconf_profile_stop(void) {
+  if (profile_pool != NULL) {
+    destroy_pool(profile_pool);
+  }
+
+  profile_pool = NULL;
+  profile_entries = NULL;
+  profile_index = NULL;
+  profile_stack = NULL;
+  profile_mark_ns = 0;
+}
+
+static struct sqlconf_profile_frame *profile_top(void) {
+  if (profile_stack == NULL ||
+      profile_stack->nelts == 0) {
+    return NULL;
+  }
+
+  return &(((struct sqlconf_profile_frame *)
+    profile_stack->elts)[profile_stack->nelts - 1]);
+}
+
+/* Charges the time elapsed since the last mark to the current frame. */
+static void profile_charge_time(void) {
+  struct sqlconf_profile_frame *frame;
+  uint64_t now_ns;
+
+  now_ns = sqlconf_stats_now();
+
+  frame = profile_top();
+  if (frame != NULL) {
+    frame->nsecs += now_ns - profile_mark_ns;
+  }
+
+  profile_mark_ns = now_ns;
+}
+
+int sqlconf_profile_enter(void) {
+  struct sqlconf_profile_frame *frame;
+
+  if (profile_stack == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  profile_charge_time();
+
+  frame = push_array(profile_stack);
+  memset(frame, 0, sizeof(struct sqlconf_profile_frame));
+
+  return 0;
+}
+
+/* Frame names are separated by semicolons, and the value follows the last
+ * space, so neither semicolons nor line breaks may appear in a name.
+ */
+static char *profile_frame_name(pool *p, const char *type,
+    const char *value) {
+  char *name, *ptr;
+
+  name = pstrcat(p, type, value != NULL && *value != '\0' ? " " : "",
+    value != NULL ? value : "", NULL);
+
+  for (ptr = name; *ptr; ptr++) {
+    if (*ptr == ';' ||
+        *ptr == '\r' ||
+        *ptr == '\n') {
+      *ptr = '_';
+    }
+  }
+
+  return name;
+}
+
+int sqlconf_profile_set_frame(const char *type, const char *value) {
+  struct sqlconf_profile_frame *frame, *frames;
+  const char *name;
+  const void *v;
+
+  if (type == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  frame = profile_top();
+  if (frame == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  name = profile_frame_name(profile_pool, type, value);
+
+  if (profile_stack->nelts > 1) {
+    frames = profile_stack->elts;
+
+    /* The parent's path is always known before its children are entered. */
+    frame->path = pstrcat(profile_pool,
+      frames[profile_stack->nelts - 2].path, ";", name, NULL);
+
+  } else {
+    frame->path = name;
+  }
+
+  /* Pushing may move the entries, so they are indexed by their position,
+   * plus one, lest the first position look like a missing entry.
+   */
+  v = pr_table_get(profile_index, frame->path, NULL);
+  if (v == NULL) {
+    struct sqlconf_profile_entry *entry;
+
+    entry = push_array(profile_entries);
+    memset(entry, 0, sizeof(struct sqlconf_profile_entry));
+    entry->path = frame->path;
+    frame->entry_idx = profile_entries->nelts - 1;
+
+    if (pr_table_add(profile_index, entry->path,
+        (void *) (uintptr_t) profile_entries->nelts, sizeof(void *)) < 0) {
+      pr_trace_msg(trace_channel, 3, "error indexing profile entry '%s': %s",
+        entry->path, strerror(errno));
+    }
+
+  } else {
+    frame->entry_idx = (uintptr_t) v - 1;
+  }
+
+  return 0;
+}
+
+int sqlconf_profile_query(unsigned long rows) {
+  struct sqlconf_profile_frame *frame;
+
+  frame = profile_top();
+  if (frame == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  frame->queries++;
+  frame->rows += rows;
+  return 0;
+}
+
+int sqlconf_profile_exit(void) {
+  struct sqlconf_profile_frame *frame, *parent;
+  struct sqlconf_profile_entry *entry;
+
+  frame = profile_top();
+  if (frame == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  profile_charge_time();
+  profile_stack->nelts--;
+
+  if (frame->path == NULL) {
+    /* The context was not rendered after all; charge its parent. */
+    parent = profile_top();
+    if (parent != NULL) {
+      parent->nsecs += frame->nsecs;
+      parent->queries += frame->queries;
+      parent->rows += frame->rows;
+    }
+
+    return 0;
+  }
+
+  entry = &(((struct sqlconf_profile_entry *)
+    profile_entries->elts)[frame->entry_idx]);
+  entry->nsecs += frame->nsecs;
+  entry->queries += frame->queries;
+  entry->rows += frame->rows;
+
+  return 0;
+}
+
+int sqlconf_profile_write(const char *path, int metric) {
+  register unsigned int i;
+  struct sqlconf_profile_entry *entries;
+  char *tmp_path = NULL;
+  FILE *fh;
+
+  if (path == NULL ||
+      (metric != CONF_SQL_PROFILE_METRIC_TIME &&
+       metric != CONF_SQL_PROFILE_METRIC_QUERIES &&
+       metric != CONF_SQL_PROFILE_METRIC_ROWS)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (profile_entries == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  fh = sqlconf_stats_open_tmp(profile_pool, path, 0644, &tmp_path);
+  if (fh == NULL) {
+    return -1;
+  }
+
+  entries = profile_entries->elts;
+  for (i = 0; i < profile_entries->nelts; i++) {
+    uint64_t val;
+
+    switch (metric) {
+      case CONF_SQL_PROFILE_METRIC_QUERIES:
+        val = entries[i].queries;
+        break;
+
+      case CONF_SQL_PROFILE_METRIC_ROWS:
+        val = entries[i].rows;
+        break;
+
+      default:
+        val = entries[i].nsecs / 1000;
+        break;
+    }
+
+    /* Frames with no cost of their own are implied by their children. */
+    if (val == 0) {
+      continue;
+    }
+
+    fprintf(fh, "%s %lu\n", entries[i].path, (unsigned long) val);
+  }
+
+  return sqlconf_stats_close_tmp(fh, tmp_path, path, TRUE);
+}
@@ -0,0 +1,59 @@
+/*
+ * ProFTPD - mod_conf_sql load profiling API
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+#include "mod_conf_sql.h"
+
+#ifndef MOD_CONF_SQL_PROFILE_H
+#define MOD_CONF_SQL_PROFILE_H
+
+/* Attributes the cost of a load to the contexts visited, keyed by the path
+ * of each context, e.g. "server;VirtualHost 10.0.0.5;Directory /srv/x".
+ * Each context is charged with its own cost, not that of its children.
+ */
+int sqlconf_profile_start(pool *p);
+void sqlconf_profile_stop(void);
+
+/* Enters a new context, whose frame name is set once known.  Contexts
+ * which exit without a frame name have their cost charged to their parent.
+ */
+int sqlconf_profile_enter(void);
+int sqlconf_profile_set_frame(const char *type, const char *value);
+int sqlconf_profile_exit(void);
+
+/* Charges a query, and the rows it returned, to the current context. */
+int sqlconf_profile_query(unsigned long rows);
+
+/* The metrics which can be written. */
+#define CONF_SQL_PROFILE_METRIC_TIME		1
+#define CONF_SQL_PROFILE_METRIC_QUERIES		2
+#define CONF_SQL_PROFILE_METRIC_ROWS		3
+
+/* Atomically replaces the given file with the given metric, in microseconds
+ * for time, per context path, in the "folded stacks" format read by
+ * flamegraph.pl.
+ */
+int sqlconf_profile_write(const char *path, int metric);
+
+#endif /* MOD_CONF_SQL_PROFILE_H */
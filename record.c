@@ -0,0 +1,482 @@
+/*
+ * ProFTPD - mod_conf_sql query record/replay
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+#include "record.h"
+#include "stats.h"
+
+/* A recording is a header, followed by one entry per query; all integers
+ * are unsigned, in network byte order:
+ *
+ *   header: "CSQLREC" version(u8)
+ *   entry:  query_len(u32) query latency_ns(u64) rnum(u32) fnum(u32)
+ *           rnum * fnum fields of: len(u32) data
+ *
+ * with a field length of CONF_SQL_RECORD_NULL for NULL fields.  Strings are
+ * not NUL-terminated.
+ */
+#define CONF_SQL_RECORD_MAGIC		"CSQLREC"
+#define CONF_SQL_RECORD_MAGIC_LEN	7
+#define CONF_SQL_RECORD_VERSION		1
+#define CONF_SQL_RECORD_NULL		0xffffffffUL
+
+/* Recording */
+static pool *record_pool = NULL;
+static FILE *record_fh = NULL;
+static const char *record_path = NULL;
+static char *record_tmp_path = NULL;
+static unsigned long record_count = 0;
+
+/* Replaying */
+struct sqlconf_replay_entry {
+  uint64_t latency_ns;
+  unsigned long rnum;
+  unsigned long fnum;
+
+  /* Offsets of the fields within the recording, and their lengths. */
+  size_t *offsets;
+  unsigned long *lens;
+};
+
+static pool *replay_pool = NULL;
+static const unsigned char *replay_data = NULL;
+static pr_table_t *replay_entries = NULL;
+static int replay_latency = CONF_SQL_REPLAY_LATENCY_NONE;
+static unsigned long replay_latency_usecs = 0;
+
+/* The hash chain count for the replay entries; each context read makes
+ * three queries.
+ */
+#define CONF_SQL_REPLAY_NCHAINS		1024
+
+static const char *trace_channel = "conf_sql";
+
+static void record_put_u32(unsigned char *buf, uint32_t val) {
+  buf[0] = (val >> 24) & 0xff;
+  buf[1] = (val >> 16) & 0xff;
+  buf[2] = (val >> 8) & 0xff;
+  buf[3] = val & 0xff;
+}
+
+static uint32_t record_get_u32(const unsigned char *buf) {
+  return ((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) |
+    ((uint32_t) buf[2] << 8) | (uint32_t) buf[3];
+}
+
+static int record_write_u32(uint32_t val) {
+  unsigned char buf[4];
+
+  record_put_u32(buf, val);
+  return fwrite(buf, sizeof(buf), 1, record_fh) == 1 ? 0 : -1;
+}
+
+static int record_write_str(const char *text) {
+  size_t len;
+
+  if (text == NULL) {
+    return record_write_u32(CONF_SQL_RECORD_NULL);
+  }
+
+  len = strlen(text);
+  if (record_write_u32(len) < 0) {
+    return -1;
+  }
+
+  if (len == 0) {
+    return 0;
+  }
+
+  return fwrite(text, len, 1, record_fh) == 1 ? 0 : -1;
+}
+
+int sqlconf_record_start(pool *p, const char *path) {
+  unsigned char version;
+  int xerrno;
+
+  if (p == NULL ||
+      path == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (record_fh != NULL) {
+    errno = EEXIST;
+    return -1;
+  }
+
+  record_pool = make_sub_pool(p);
+  pr_pool_tag(record_pool, "SQL Configuration Record Pool");
+
+  record_path = pstrdup(record_pool, path);
+
+  /* The results recorded may include credentials, e.g. SQLConnectInfo
+   * directives, so only the owner may read the recording.
+   */
+  record_fh = sqlconf_stats_open_tmp(record_pool, path, 0600,
+    &record_tmp_path);
+  if (record_fh == NULL) {
+    xerrno = errno;
+
+    destroy_pool(record_pool);
+    record_pool = NULL;
+    errno = xerrno;
+    return -1;
+  }
+
+  version = CONF_SQL_RECORD_VERSION;
+  if (fwrite(CONF_SQL_RECORD_MAGIC, CONF_SQL_RECORD_MAGIC_LEN, 1,
+      record_fh) != 1 ||
+      fwrite(&version, 1, 1, record_fh) != 1) {
+    xerrno = errno;
+
+    (void) sqlconf_record_stop(FALSE);
+    errno = xerrno;
+    return -1;
+  }
+
+  record_count = 0;
+  return 0;
+}
+
+int sqlconf_record_add(const char *query, uint64_t latency_ns,
+    sql_data_t *sd) {
+  register unsigned long i;
+  unsigned char buf[8];
+
+  if (query == NULL ||
+      sd == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (record_fh == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  if (record_write_str(query) < 0) {
+    return -1;
+  }
+
+  record_put_u32(buf, (uint32_t) (latency_ns >> 32));
+  record_put_u32(buf + 4, (uint32_t) (latency_ns & 0xffffffffUL));
+  if (fwrite(buf, sizeof(buf), 1, record_fh) != 1 ||
+      record_write_u32(sd->rnum) < 0 ||
+      record_write_u32(sd->fnum) < 0) {
+    return -1;
+  }
+
+  for (i = 0; i < sd->rnum * sd->fnum; i++) {
+    if (record_write_str(sd->data[i]) < 0) {
+      return -1;
+    }
+  }
+
+  record_count++;
+  return 0;
+}
+
+int sqlconf_record_stop(int keep) {
+  int res, xerrno;
+
+  if (record_fh == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  res = sqlconf_stats_close_tmp(record_fh, record_tmp_path, record_path,
+    keep);
+  xerrno = errno;
+  record_fh = NULL;
+
+  if (res == 0 &&
+      keep == TRUE) {
+    pr_trace_msg(trace_channel, 8, "recorded %lu queries to '%s'",
+      record_count, record_path);
+  }
+
+  destroy_pool(record_pool);
+  record_pool = NULL;
+  record_path = record_tmp_path = NULL;
+  record_count = 0;
+
+  errno = xerrno;
+  return res;
+}
+
+/* Parses the entry at the given offset, advancing it past the entry. */
+static int replay_parse_entry(const unsigned char *data, size_t datalen,
+    size_t *off) {
+  register unsigned long i;
+  struct sqlconf_replay_entry *entry;
+  uint32_t query_len;
+  unsigned long nfields;
+  size_t pos;
+  char *query;
+
+  pos = *off;
+  if (datalen - pos < 4) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  query_len = record_get_u32(data + pos);
+  pos += 4;
+  if (query_len == CONF_SQL_RECORD_NULL ||
+      datalen - pos < (size_t) query_len + 16) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  query = pstrndup(replay_pool, (const char *) data + pos, query_len);
+  pos += query_len;
+
+  entry = pcalloc(replay_pool, sizeof(struct sqlconf_replay_entry));
+  entry->latency_ns = ((uint64_t) record_get_u32(data + pos) << 32) |
+    record_get_u32(data + pos + 4);
+  entry->rnum = record_get_u32(data + pos + 8);
+  entry->fnum = record_get_u32(data + pos + 12);
+  pos += 16;
+
+  /* Each field takes at least its length, which bounds the field count by
+   * the remaining data, before multiplying.
+   */
+  if (entry->fnum != 0 &&
+      entry->rnum > (datalen - pos) / 4 / entry->fnum) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  nfields = entry->rnum * entry->fnum;
+  entry->offsets = palloc(replay_pool, sizeof(size_t) * (nfields + 1));
+  entry->lens = palloc(replay_pool, sizeof(unsigned long) * (nfields + 1));
+
+  for (i = 0; i < nfields; i++) {
+    uint32_t len;
+
+    if (datalen - pos < 4) {
+      errno = EINVAL;
+      return -1;
+    }
+
+    len = record_get_u32(data + pos);
+    pos += 4;
+
+    entry->offsets[i] = pos;
+    entry->lens[i] = len;
+
+    if (len != CONF_SQL_RECORD_NULL) {
+      if (datalen - pos < len) {
+        errno = EINVAL;
+        return -1;
+      }
+
+      pos += len;
+    }
+  }
+
+  /* Queries recorded more than once are answered with their first
+   * results.
+   */
+  if (pr_table_get(replay_entries, query, NULL) == NULL) {
+    if (pr_table_add(replay_entries, query, entry,
+        sizeof(struct sqlconf_replay_entry)) < 0) {
+      return -1;
+    }
+  }
+
+  *off = pos;
+  return 0;
+}
+
+/* Reads the entire recording into memory, indexing each entry by its
+ * query.
+ */
+static int replay_parse(const unsigned char *data, size_t datalen) {
+  size_t off;
+  unsigned long nentries = 0;
+
+  if (datalen < CONF_SQL_RECORD_MAGIC_LEN + 1 ||
+      memcmp(data, CONF_SQL_RECORD_MAGIC, CONF_SQL_RECORD_MAGIC_LEN) != 0 ||
+      data[CONF_SQL_RECORD_MAGIC_LEN] != CONF_SQL_RECORD_VERSION) {
+    pr_trace_msg(trace_channel, 2, "replay: not a version %u recording",
+      CONF_SQL_RECORD_VERSION);
+    errno = EINVAL;
+    return -1;
+  }
+
+  off = CONF_SQL_RECORD_MAGIC_LEN + 1;
+  while (off < datalen) {
+    if (replay_parse_entry(data, datalen, &off) < 0) {
+      int xerrno = errno;
+
+      pr_trace_msg(trace_channel, 2,
+        "replay: truncated or malformed entry at offset %lu",
+        (unsigned long) off);
+      errno = xerrno;
+      return -1;
+    }
+
+    nentries++;
+  }
+
+  pr_trace_msg(trace_channel, 8, "replay: read %lu queries (%d unique)",
+    nentries, pr_table_count(replay_entries));
+  return 0;
+}
+
+int sqlconf_replay_start(pool *p, const char *path, int latency,
+    unsigned long latency_usecs) {
+  int max_ents = INT_MAX, xerrno;
+  unsigned char *data;
+  struct stat st;
+  FILE *fh;
+
+  if (p == NULL ||
+      path == NULL ||
+      (latency != CONF_SQL_REPLAY_LATENCY_NONE &&
+       latency != CONF_SQL_REPLAY_LATENCY_RECORDED &&
+       latency != CONF_SQL_REPLAY_LATENCY_FIXED)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (replay_pool != NULL) {
+    errno = EEXIST;
+    return -1;
+  }
+
+  fh = fopen(path, "r");
+  if (fh == NULL) {
+    return -1;
+  }
+
+  if (fstat(fileno(fh), &st) < 0) {
+    xerrno = errno;
+
+    fclose(fh);
+    errno = xerrno;
+    return -1;
+  }
+
+  replay_pool = make_sub_pool(p);
+  pr_pool_tag(replay_pool, "SQL Configuration Replay Pool");
+
+  data = palloc(replay_pool, st.st_size + 1);
+  if (st.st_size > 0 &&
+      fread(data, (size_t) st.st_size, 1, fh) != 1) {
+    fclose(fh);
+    sqlconf_replay_stop();
+    errno = EIO;
+    return -1;
+  }
+  fclose(fh);
+
+  replay_entries = pr_table_nalloc(replay_pool, 0, CONF_SQL_REPLAY_NCHAINS);
+  (void) pr_table_ctl(replay_entries, PR_TABLE_CTL_SET_MAX_ENTS, &max_ents);
+
+  if (replay_parse(data, (size_t) st.st_size) < 0) {
+    xerrno = errno;
+
+    sqlconf_replay_stop();
+    errno = xerrno;
+    return -1;
+  }
+
+  replay_data = data;
+  replay_latency = latency;
+  replay_latency_usecs = latency_usecs;
+
+  return 0;
+}
+
+void sqlconf_replay_stop(void) {
+  if (replay_pool != NULL) {
+    destroy_pool(replay_pool);
+  }
+
+  replay_pool = NULL;
+  replay_data = NULL;
+  replay_entries = NULL;
+  replay_latency = CONF_SQL_REPLAY_LATENCY_NONE;
+  replay_latency_usecs = 0;
+}
+
+int sqlconf_replay_select(pool *p, const char *query, sql_data_t **sd) {
+  register unsigned long i;
+  const struct sqlconf_replay_entry *entry;
+  unsigned long usecs = 0, nfields;
+  sql_data_t *res;
+
+  if (p == NULL ||
+      query == NULL ||
+      sd == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (replay_entries == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  entry = pr_table_get(replay_entries, query, NULL);
+  if (entry == NULL) {
+    pr_trace_msg(trace_channel, 2, "replay: query not recorded: SELECT %s",
+      query);
+    errno = ENOENT;
+    return -1;
+  }
+
+  switch (replay_latency) {
+    case CONF_SQL_REPLAY_LATENCY_RECORDED:
+      usecs = (unsigned long) (entry->latency_ns / 1000);
+      break;
+
+    case CONF_SQL_REPLAY_LATENCY_FIXED:
+      usecs = replay_latency_usecs;
+      break;
+  }
+
+  if (usecs > 0) {
+    (void) pr_timer_usleep(usecs);
+  }
+
+  /* As with mod_sql, each select returns its own copy of the results. */
+  res = pcalloc(p, sizeof(sql_data_t));
+  res->rnum = entry->rnum;
+  res->fnum = entry->fnum;
+
+  nfields = entry->rnum * entry->fnum;
+  res->data = pcalloc(p, sizeof(char *) * (nfields + 1));
+  for (i = 0; i < nfields; i++) {
+    if (entry->lens[i] != CONF_SQL_RECORD_NULL) {
+      res->data[i] = pstrndup(p, (const char *) replay_data +
+        entry->offsets[i], entry->lens[i]);
+    }
+  }
+
+  *sd = res;
+  return 0;
+}
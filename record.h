@@ -0,0 +1,61 @@
+/*
+ * ProFTPD - mod_conf_sql query record/replay API
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+#include "mod_sql.h"
+
+#ifndef MOD_CONF_SQL_RECORD_H
+#define MOD_CONF_SQL_RECORD_H
+
+/* Records the queries of a load, with their results and latencies, to a
+ * file which can later be replayed in place of the database.  Queries are
+ * recorded by their text, sans the leading "SELECT".
+ */
+int sqlconf_record_start(pool *p, const char *path);
+int sqlconf_record_add(const char *query, uint64_t latency_ns,
+  sql_data_t *sd);
+
+/* Atomically replaces the recording file, if the recording is to be kept,
+ * and stops recording.
+ */
+int sqlconf_record_stop(int keep);
+
+/* How the recorded latencies are reproduced when replaying. */
+#define CONF_SQL_REPLAY_LATENCY_NONE		0
+#define CONF_SQL_REPLAY_LATENCY_RECORDED	1
+#define CONF_SQL_REPLAY_LATENCY_FIXED		2
+
+/* Reads the given recording, for serving results until stopped.  For fixed
+ * latencies, every query is delayed by the given number of microseconds.
+ */
+int sqlconf_replay_start(pool *p, const char *path, int latency,
+  unsigned long latency_usecs);
+void sqlconf_replay_stop(void);
+
+/* Returns the recorded results of the given query, allocated from the given
+ * pool, or -1 with ENOENT if the query was not recorded.
+ */
+int sqlconf_replay_select(pool *p, const char *query, sql_data_t **sd);
+
+#endif /* MOD_CONF_SQL_RECORD_H */
@@ -0,0 +1,26 @@
+-- The configuration, stored as one JSON document, for reading with a single
+-- query, using e.g.:
+--
+--   sql:///etc/proftpd/conf.db?doc=ftpdoc
+--
+-- The document is either a list of the directives and contexts of the base
+-- context, or a context object, e.g.:
+--
+--   [
+--     "ServerName \"Test\"",
+--     {"type": "VirtualHost", "value": "127.0.0.1", "config": [
+--       "Port 2121",
+--       ["AllowUser", "bob", "alice"],
+--       {"type": "Directory", "value": "/tmp", "config": ["Umask 022"]}
+--     ]}
+--   ]
+--
+-- Directives are given either as text, as they would appear in a
+-- configuration file, or as a list of their name and arguments.  A table
+-- holding several documents is read using the base_id parameter, to select
+-- the document by its id.
+
+CREATE TABLE IF NOT EXISTS ftpdoc (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  doc TEXT NOT NULL CHECK (json_valid(doc))
+);
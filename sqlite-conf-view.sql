@@ -0,0 +1,43 @@
+-- The configuration, rendered by the database as ordered lines, for reading
+-- with a single query, using e.g.:
+--
+--   sql:///etc/proftpd/conf.db?view=ftpconf_lines
+--
+-- The lines are those mod_conf_sql renders when walking the tables: the
+-- directives of the base context (the context without a parent), then each
+-- of its child contexts, with their directives and child contexts, by ID.
+-- Window functions require SQLite 3.25.0 or later.
+
+DROP VIEW IF EXISTS ftpconf_lines;
+
+CREATE VIEW ftpconf_lines (seq, line) AS
+  WITH RECURSIVE ctxs (id, type, value, path) AS (
+    SELECT id, type, value, ''
+      FROM ftpctx
+      WHERE parent_id IS NULL
+    UNION ALL
+    SELECT ftpctx.id, ftpctx.type, ftpctx.value,
+        ctxs.path || 'c' || printf('%010d', ftpctx.id)
+      FROM ftpctx
+      INNER JOIN ctxs ON ftpctx.parent_id = ctxs.id
+  ),
+  rendered (sortkey, line) AS (
+    SELECT path || 'a',
+        '<' || type ||
+        CASE WHEN value IS NULL OR value = '' THEN '' ELSE ' ' || value END ||
+        '>'
+      FROM ctxs
+      WHERE path <> ''
+    UNION ALL
+    SELECT ctxs.path || 'b' || printf('%010d', ftpconf.id),
+        ftpconf.name || ' ' || COALESCE(CAST(ftpconf.value AS TEXT), '')
+      FROM ctxs
+      INNER JOIN ftpmap ON ftpmap.ctx_id = ctxs.id
+      INNER JOIN ftpconf ON ftpconf.id = ftpmap.conf_id
+    UNION ALL
+    SELECT path || 'd', '</' || type || '>'
+      FROM ctxs
+      WHERE path <> ''
+  )
+  SELECT ROW_NUMBER() OVER (ORDER BY sortkey), line
+    FROM rendered;
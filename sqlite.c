@@ -0,0 +1,294 @@
+/*
+ * ProFTPD - mod_conf_sql SQLite implementation
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+#include "sqlite.h"
+
+#ifdef CONF_SQL_USE_SQLITE3
+#include <sqlite3.h>
+
+static sqlite3 *sqlite_db = NULL;
+static sqlite3_stmt *sqlite_stmts[CONF_SQL_QUERY_MAX+1];
+
+static const char *trace_channel = "conf_sql";
+
+/* Build a "file:" URI for the given path, for use with SQLITE_OPEN_URI. */
+static char *sqlite_file_uri(pool *p, const char *path, const char *query) {
+  const char *ptr;
+  char *uri, *dst;
+
+  /* Worst case, every character needs to be percent-encoded. */
+  uri = dst = palloc(p, (strlen(path) * 3) + strlen(query) + 7);
+
+  memcpy(dst, "file:", 5);
+  dst += 5;
+
+  for (ptr = path; *ptr; ptr++) {
+    if (*ptr == '%' ||
+        *ptr == '?' ||
+        *ptr == '#') {
+      snprintf(dst, 4, "%%%02X", (unsigned char) *ptr);
+      dst += 3;
+
+    } else {
+      *dst++ = *ptr;
+    }
+  }
+
+  *dst++ = '?';
+  strcpy(dst, query);
+
+  return uri;
+}
+
+static int sqlite_exec_pragma(pool *p, const char *pragma) {
+  int res;
+  char *errmsg = NULL;
+
+  pr_trace_msg(trace_channel, 9, "executing SQLite pragma '%s'", pragma);
+
+  res = sqlite3_exec(sqlite_db, pragma, NULL, NULL, &errmsg);
+  if (res != SQLITE_OK) {
+    pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+      ": error executing SQLite '%s': %s", pragma,
+      errmsg ? errmsg : sqlite3_errstr(res));
+    sqlite3_free(errmsg);
+    errno = EINVAL;
+    return -1;
+  }
+
+  return 0;
+}
+
+int sqlconf_sqlite_open(pool *p, const char *path, int flags,
+    long mmap_size) {
+  int res, open_flags;
+  const char *filename;
+
+  if (p == NULL ||
+      path == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (sqlite_db != NULL) {
+    (void) sqlconf_sqlite_close();
+  }
+
+  memset(sqlite_stmts, 0, sizeof(sqlite_stmts));
+
+  open_flags = SQLITE_OPEN_READONLY;
+  filename = path;
+
+  if (flags & CONF_SQL_SQLITE_FL_IMMUTABLE) {
+    /* Immutable databases are never locked, nor checked for changes. */
+    open_flags |= SQLITE_OPEN_URI;
+    filename = sqlite_file_uri(p, path, "immutable=1");
+  }
+
+  pr_trace_msg(trace_channel, 9, "opening SQLite database '%s'", filename);
+
+  res = sqlite3_open_v2(filename, &sqlite_db, open_flags, NULL);
+  if (res != SQLITE_OK) {
+    pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+      ": error opening SQLite database '%s': %s", path,
+      sqlite_db ? sqlite3_errmsg(sqlite_db) : sqlite3_errstr(res));
+
+    if (sqlite_db != NULL) {
+      sqlite3_close(sqlite_db);
+      sqlite_db = NULL;
+    }
+
+    errno = ENOENT;
+    return -1;
+  }
+
+  if (flags & CONF_SQL_SQLITE_FL_QUERY_ONLY) {
+    if (sqlite_exec_pragma(p, "PRAGMA query_only = 1") < 0) {
+      (void) sqlconf_sqlite_close();
+      errno = EINVAL;
+      return -1;
+    }
+  }
+
+  if (mmap_size >= 0) {
+    char pragma[64];
+
+    memset(pragma, '\0', sizeof(pragma));
+    snprintf(pragma, sizeof(pragma)-1, "PRAGMA mmap_size = %ld", mmap_size);
+
+    if (sqlite_exec_pragma(p, pragma) < 0) {
+      (void) sqlconf_sqlite_close();
+      errno = EINVAL;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int sqlconf_sqlite_close(void) {
+  register unsigned int i;
+
+  if (sqlite_db == NULL) {
+    return 0;
+  }
+
+  for (i = 0; i <= CONF_SQL_QUERY_MAX; i++) {
+    if (sqlite_stmts[i] != NULL) {
+      sqlite3_finalize(sqlite_stmts[i]);
+      sqlite_stmts[i] = NULL;
+    }
+  }
+
+  if (sqlite3_close(sqlite_db) != SQLITE_OK) {
+    pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+      ": error closing SQLite database: %s", sqlite3_errmsg(sqlite_db));
+  }
+
+  sqlite_db = NULL;
+  return 0;
+}
+
+int sqlconf_sqlite_prepare(unsigned int shape, const char *query) {
+  int res;
+  char *sql;
+
+  if (shape > CONF_SQL_QUERY_MAX ||
+      query == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (sqlite_db == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  if (sqlite_stmts[shape] != NULL) {
+    sqlite3_finalize(sqlite_stmts[shape]);
+    sqlite_stmts[shape] = NULL;
+  }
+
+  sql = sqlite3_mprintf("SELECT %s", query);
+  if (sql == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  pr_trace_msg(trace_channel, 9, "preparing SQLite statement '%s'", sql);
+
+  res = sqlite3_prepare_v2(sqlite_db, sql, -1, &(sqlite_stmts[shape]), NULL);
+  if (res != SQLITE_OK) {
+    pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
+      ": error preparing SQLite statement '%s': %s", sql,
+      sqlite3_errmsg(sqlite_db));
+    sqlite3_free(sql);
+    errno = EINVAL;
+    return -1;
+  }
+
+  sqlite3_free(sql);
+  return 0;
+}
+
+int sqlconf_sqlite_select(pool *p, unsigned int shape, int ctx_id,
+    sql_data_t **sd) {
+  int res;
+  sqlite3_stmt *stmt;
+  array_header *values;
+  unsigned long nrows = 0, ncols;
+
+  if (p == NULL ||
+      shape > CONF_SQL_QUERY_MAX ||
+      sd == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  stmt = sqlite_stmts[shape];
+  if (stmt == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  if (sqlite3_bind_parameter_count(stmt) > 0) {
+    res = sqlite3_bind_int(stmt, 1, ctx_id);
+    if (res != SQLITE_OK) {
+      pr_trace_msg(trace_channel, 9, "error binding context ID %d: %s",
+        ctx_id, sqlite3_errmsg(sqlite_db));
+      sqlite3_reset(stmt);
+      errno = EINVAL;
+      return -1;
+    }
+  }
+
+  ncols = sqlite3_column_count(stmt);
+  values = make_array(p, ncols, sizeof(char *));
+
+  res = sqlite3_step(stmt);
+  while (res == SQLITE_ROW) {
+    register unsigned long i;
+
+    pr_signals_handle();
+
+    for (i = 0; i < ncols; i++) {
+      const unsigned char *text;
+      int textsz;
+
+      /* Note that NULL values are returned as empty strings. */
+      text = sqlite3_column_text(stmt, i);
+      textsz = sqlite3_column_bytes(stmt, i);
+
+      *((char **) push_array(values)) = text != NULL ?
+        pstrndup(p, (const char *) text, textsz) : pstrdup(p, "");
+    }
+
+    nrows++;
+    res = sqlite3_step(stmt);
+  }
+
+  if (res != SQLITE_DONE) {
+    pr_trace_msg(trace_channel, 9, "SQLite SELECT error: %s",
+      sqlite3_errmsg(sqlite_db));
+    sqlite3_reset(stmt);
+    errno = EIO;
+    return -1;
+  }
+
+  sqlite3_reset(stmt);
+
+  *sd = pcalloc(p, sizeof(sql_data_t));
+  (*sd)->rnum = nrows;
+  (*sd)->fnum = ncols;
+  (*sd)->data = values->elts;
+
+  return 0;
+}
+
+int64_t sqlconf_sqlite_memory_used(void) {
+  return (int64_t) sqlite3_memory_used();
+}
+
+#endif /* CONF_SQL_USE_SQLITE3 */
@@ -0,0 +1,58 @@
+/*
+ * ProFTPD - mod_conf_sql SQLite API
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+#include "mod_sql.h"
+
+#ifndef MOD_CONF_SQL_SQLITE_H
+#define MOD_CONF_SQL_SQLITE_H
+
+#ifdef CONF_SQL_USE_SQLITE3
+
+/* Opens the given SQLite database file, read-only. */
+int sqlconf_sqlite_open(pool *p, const char *path, int flags,
+  long mmap_size);
+#define CONF_SQL_SQLITE_FL_IMMUTABLE		0x0001
+#define CONF_SQL_SQLITE_FL_QUERY_ONLY		0x0002
+
+int sqlconf_sqlite_close(void);
+
+/* Prepares the statement for the given query shape.  The query text omits
+ * the leading "SELECT", and uses a "?" placeholder for the context ID.
+ */
+int sqlconf_sqlite_prepare(unsigned int shape, const char *query);
+
+/* Executes the prepared statement for the given query shape, binding the
+ * given context ID if the statement uses one, and collects the results in
+ * the same form as mod_sql.
+ */
+int sqlconf_sqlite_select(pool *p, unsigned int shape, int ctx_id,
+  sql_data_t **sd);
+
+/* Returns the bytes currently allocated by the SQLite library. */
+int64_t sqlconf_sqlite_memory_used(void);
+
+#endif /* CONF_SQL_USE_SQLITE3 */
+
+#endif /* MOD_CONF_SQL_SQLITE_H */
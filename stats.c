@@ -0,0 +1,876 @@
+/*
+ * ProFTPD - mod_conf_sql statistics implementation
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+#include "stats.h"
+
+#ifdef HAVE_SYS_RESOURCE_H
+# include <sys/resource.h>
+#endif
+
+static uint64_t mem_allocated[CONF_SQL_MEM_MAX+1];
+static uint64_t mem_in_use[CONF_SQL_MEM_MAX+1];
+static uint64_t mem_total_in_use = 0;
+static uint64_t mem_peak = 0;
+
+static struct sqlconf_usage usage_begin, usage_end;
+static int usage_sampled = FALSE;
+
+static const char *mem_phases[CONF_SQL_MEM_MAX+1] = {
+  "uri",
+  "backend",
+  "results",
+  "lines",
+  "snapshot",
+  "lookup"
+};
+
+static uint64_t time_nsecs[CONF_SQL_TIME_MAX+1];
+static uint64_t counts[CONF_SQL_COUNT_MAX+1];
+static struct sqlconf_hist query_hists[CONF_SQL_QUERY_MAX+1];
+
+static const char *time_phases[CONF_SQL_TIME_MAX+1] = {
+  "open",
+  "query",
+  "render",
+  "close",
+  "total"
+};
+
+static const char *query_shapes[CONF_SQL_QUERY_MAX+1] = {
+  "base_ctx",
+  "ctx",
+  "confs",
+  "child_ctxs",
+  "lines",
+  "doc"
+};
+
+/* Timings of the mod_sql hooks called, keyed by the hook name.  Only a
+ * handful of distinct hooks are ever used.
+ */
+struct sqlconf_dispatch_stats {
+  const char *name;
+  uint64_t count;
+  uint64_t total_nsecs;
+  uint64_t max_nsecs;
+};
+
+#define CONF_SQL_STATS_MAX_HOOKS	8
+static struct sqlconf_dispatch_stats dispatch_stats[CONF_SQL_STATS_MAX_HOOKS];
+
+static const char *load_backend = NULL;
+static int load_fallback = FALSE;
+
+static const char *trace_channel = "conf_sql";
+
+void sqlconf_stats_reset(void) {
+  memset(mem_allocated, 0, sizeof(mem_allocated));
+  memset(mem_in_use, 0, sizeof(mem_in_use));
+  mem_total_in_use = 0;
+  mem_peak = 0;
+
+  memset(&usage_begin, 0, sizeof(usage_begin));
+  memset(&usage_end, 0, sizeof(usage_end));
+  usage_sampled = FALSE;
+
+  memset(time_nsecs, 0, sizeof(time_nsecs));
+  memset(counts, 0, sizeof(counts));
+  memset(query_hists, 0, sizeof(query_hists));
+  memset(dispatch_stats, 0, sizeof(dispatch_stats));
+
+  load_backend = NULL;
+  load_fallback = FALSE;
+}
+
+struct sqlconf_stats_state {
+  uint64_t mem_allocated[CONF_SQL_MEM_MAX+1];
+  uint64_t mem_in_use[CONF_SQL_MEM_MAX+1];
+  uint64_t mem_total_in_use;
+  uint64_t mem_peak;
+
+  struct sqlconf_usage usage_begin, usage_end;
+  int usage_sampled;
+
+  uint64_t time_nsecs[CONF_SQL_TIME_MAX+1];
+  uint64_t counts[CONF_SQL_COUNT_MAX+1];
+  struct sqlconf_hist query_hists[CONF_SQL_QUERY_MAX+1];
+  struct sqlconf_dispatch_stats dispatch_stats[CONF_SQL_STATS_MAX_HOOKS];
+
+  const char *load_backend;
+  int load_fallback;
+};
+
+struct sqlconf_stats_state *sqlconf_stats_save(pool *p) {
+  struct sqlconf_stats_state *state;
+
+  if (p == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  state = palloc(p, sizeof(struct sqlconf_stats_state));
+
+  memcpy(state->mem_allocated, mem_allocated, sizeof(mem_allocated));
+  memcpy(state->mem_in_use, mem_in_use, sizeof(mem_in_use));
+  state->mem_total_in_use = mem_total_in_use;
+  state->mem_peak = mem_peak;
+
+  state->usage_begin = usage_begin;
+  state->usage_end = usage_end;
+  state->usage_sampled = usage_sampled;
+
+  memcpy(state->time_nsecs, time_nsecs, sizeof(time_nsecs));
+  memcpy(state->counts, counts, sizeof(counts));
+  memcpy(state->query_hists, query_hists, sizeof(query_hists));
+  memcpy(state->dispatch_stats, dispatch_stats, sizeof(dispatch_stats));
+
+  state->load_backend = load_backend;
+  state->load_fallback = load_fallback;
+
+  return state;
+}
+
+int sqlconf_stats_restore(const struct sqlconf_stats_state *state) {
+  if (state == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  memcpy(mem_allocated, state->mem_allocated, sizeof(mem_allocated));
+  memcpy(mem_in_use, state->mem_in_use, sizeof(mem_in_use));
+  mem_total_in_use = state->mem_total_in_use;
+  mem_peak = state->mem_peak;
+
+  usage_begin = state->usage_begin;
+  usage_end = state->usage_end;
+  usage_sampled = state->usage_sampled;
+
+  memcpy(time_nsecs, state->time_nsecs, sizeof(time_nsecs));
+  memcpy(counts, state->counts, sizeof(counts));
+  memcpy(query_hists, state->query_hists, sizeof(query_hists));
+  memcpy(dispatch_stats, state->dispatch_stats, sizeof(dispatch_stats));
+
+  load_backend = state->load_backend;
+  load_fallback = state->load_fallback;
+
+  return 0;
+}
+
+int sqlconf_stats_mem_alloc(unsigned int phase, size_t len) {
+  if (phase > CONF_SQL_MEM_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  mem_allocated[phase] += len;
+  mem_in_use[phase] += len;
+
+  mem_total_in_use += len;
+  if (mem_total_in_use > mem_peak) {
+    mem_peak = mem_total_in_use;
+  }
+
+  return 0;
+}
+
+int sqlconf_stats_mem_release(unsigned int phase, size_t len) {
+  if (phase > CONF_SQL_MEM_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (len > mem_in_use[phase]) {
+    /* Releasing more than was allocated is a bookkeeping error. */
+    errno = EPERM;
+    return -1;
+  }
+
+  mem_in_use[phase] -= len;
+  mem_total_in_use -= len;
+
+  return 0;
+}
+
+int sqlconf_stats_mem_get(unsigned int phase, uint64_t *allocated,
+    uint64_t *in_use) {
+  if (phase > CONF_SQL_MEM_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (allocated != NULL) {
+    *allocated = mem_allocated[phase];
+  }
+
+  if (in_use != NULL) {
+    *in_use = mem_in_use[phase];
+  }
+
+  return 0;
+}
+
+uint64_t sqlconf_stats_mem_peak(void) {
+  return mem_peak;
+}
+
+const char *sqlconf_stats_mem_phase(unsigned int phase) {
+  if (phase > CONF_SQL_MEM_MAX) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  return mem_phases[phase];
+}
+
+static long stats_get_rss_kb(void) {
+  long rss_kb = 0;
+#ifdef __linux__
+  FILE *fh;
+
+  /* The second field of statm is the resident set size, in pages. */
+  fh = fopen("/proc/self/statm", "r");
+  if (fh != NULL) {
+    long size, resident;
+
+    if (fscanf(fh, "%ld %ld", &size, &resident) == 2) {
+      rss_kb = resident * (sysconf(_SC_PAGESIZE) / 1024);
+    }
+
+    fclose(fh);
+  }
+#endif /* __linux__ */
+
+  return rss_kb;
+}
+
+static int stats_get_usage(struct sqlconf_usage *usage) {
+#ifdef HAVE_SYS_RESOURCE_H
+  struct rusage ru;
+
+  if (getrusage(RUSAGE_SELF, &ru) < 0) {
+    return -1;
+  }
+
+  usage->maxrss_kb = ru.ru_maxrss;
+# ifdef __APPLE__
+  /* macOS reports the high-water mark in bytes, not KB. */
+  usage->maxrss_kb /= 1024;
+# endif /* __APPLE__ */
+  usage->minflt = ru.ru_minflt;
+  usage->majflt = ru.ru_majflt;
+  usage->utime_usecs = ((long long) ru.ru_utime.tv_sec * 1000000) +
+    ru.ru_utime.tv_usec;
+  usage->stime_usecs = ((long long) ru.ru_stime.tv_sec * 1000000) +
+    ru.ru_stime.tv_usec;
+#endif /* HAVE_SYS_RESOURCE_H */
+
+  usage->rss_kb = stats_get_rss_kb();
+  return 0;
+}
+
+int sqlconf_stats_usage_begin(void) {
+  memset(&usage_begin, 0, sizeof(usage_begin));
+  memset(&usage_end, 0, sizeof(usage_end));
+  usage_sampled = FALSE;
+
+  return stats_get_usage(&usage_begin);
+}
+
+int sqlconf_stats_usage_end(void) {
+  if (stats_get_usage(&usage_end) < 0) {
+    return -1;
+  }
+
+  usage_sampled = TRUE;
+  return 0;
+}
+
+int sqlconf_stats_usage_get(struct sqlconf_usage *delta) {
+  if (delta == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (usage_sampled == FALSE) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  delta->rss_kb = usage_end.rss_kb - usage_begin.rss_kb;
+  delta->maxrss_kb = usage_end.maxrss_kb - usage_begin.maxrss_kb;
+  delta->minflt = usage_end.minflt - usage_begin.minflt;
+  delta->majflt = usage_end.majflt - usage_begin.majflt;
+  delta->utime_usecs = usage_end.utime_usecs - usage_begin.utime_usecs;
+  delta->stime_usecs = usage_end.stime_usecs - usage_begin.stime_usecs;
+
+  return 0;
+}
+
+void sqlconf_stats_log_memory(void) {
+  register unsigned int i;
+  struct sqlconf_usage delta;
+
+  for (i = 0; i <= CONF_SQL_MEM_MAX; i++) {
+    pr_trace_msg(trace_channel, 8,
+      "memory: %s: %" PR_LU " bytes allocated, %" PR_LU " bytes in use",
+      mem_phases[i], (pr_off_t) mem_allocated[i], (pr_off_t) mem_in_use[i]);
+  }
+
+  pr_trace_msg(trace_channel, 8, "memory: peak: %" PR_LU " bytes",
+    (pr_off_t) mem_peak);
+
+  if (sqlconf_stats_usage_get(&delta) == 0) {
+    pr_trace_msg(trace_channel, 8,
+      "usage: RSS %+ld KB, max RSS %+ld KB, %ld minor/%ld major faults, "
+      "user %lld.%06lld sec, sys %lld.%06lld sec", delta.rss_kb,
+      delta.maxrss_kb, delta.minflt, delta.majflt,
+      delta.utime_usecs / 1000000, delta.utime_usecs % 1000000,
+      delta.stime_usecs / 1000000, delta.stime_usecs % 1000000);
+
+    pr_log_debug(DEBUG3, MOD_CONF_SQL_VERSION
+      ": configuration load used %" PR_LU " bytes (peak %" PR_LU " bytes), "
+      "RSS %+ld KB", (pr_off_t) (mem_allocated[CONF_SQL_MEM_LINES] +
+      mem_allocated[CONF_SQL_MEM_SNAPSHOT]), (pr_off_t) mem_peak,
+      delta.rss_kb);
+  }
+}
+
+uint64_t sqlconf_stats_now(void) {
+  struct timeval tv;
+
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+    return ((uint64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+  }
+#endif /* CLOCK_MONOTONIC */
+
+  /* Fall back to the wall clock. */
+  gettimeofday(&tv, NULL);
+  return ((uint64_t) tv.tv_sec * 1000000000) + ((uint64_t) tv.tv_usec * 1000);
+}
+
+int sqlconf_stats_time_add(unsigned int phase, uint64_t nsecs) {
+  if (phase > CONF_SQL_TIME_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  time_nsecs[phase] += nsecs;
+  return 0;
+}
+
+int sqlconf_stats_time_get(unsigned int phase, uint64_t *nsecs) {
+  if (phase > CONF_SQL_TIME_MAX ||
+      nsecs == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  *nsecs = time_nsecs[phase];
+  return 0;
+}
+
+int sqlconf_stats_count_add(unsigned int counter, uint64_t n) {
+  if (counter > CONF_SQL_COUNT_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  counts[counter] += n;
+  return 0;
+}
+
+int sqlconf_stats_count_get(unsigned int counter, uint64_t *n) {
+  if (counter > CONF_SQL_COUNT_MAX ||
+      n == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  *n = counts[counter];
+  return 0;
+}
+
+int sqlconf_stats_query_add(unsigned int shape, uint64_t nsecs) {
+  struct sqlconf_hist *hist;
+  uint64_t usecs;
+  unsigned int i;
+
+  if (shape > CONF_SQL_QUERY_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  hist = &(query_hists[shape]);
+  hist->count++;
+  hist->total_nsecs += nsecs;
+  if (nsecs > hist->max_nsecs) {
+    hist->max_nsecs = nsecs;
+  }
+
+  usecs = nsecs / 1000;
+  for (i = 0; i < CONF_SQL_HIST_NBUCKETS - 1; i++) {
+    if (usecs < ((uint64_t) 1 << i)) {
+      break;
+    }
+  }
+
+  hist->buckets[i]++;
+
+  counts[CONF_SQL_COUNT_QUERIES]++;
+  time_nsecs[CONF_SQL_TIME_QUERY] += nsecs;
+  return 0;
+}
+
+int sqlconf_stats_query_get(unsigned int shape, struct sqlconf_hist *hist) {
+  if (shape > CONF_SQL_QUERY_MAX ||
+      hist == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  memcpy(hist, &(query_hists[shape]), sizeof(struct sqlconf_hist));
+  return 0;
+}
+
+int sqlconf_stats_dispatch_add(const char *name, uint64_t nsecs) {
+  register unsigned int i;
+  struct sqlconf_dispatch_stats *stats = NULL;
+
+  if (name == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  for (i = 0; i < CONF_SQL_STATS_MAX_HOOKS; i++) {
+    if (dispatch_stats[i].name == NULL) {
+      stats = &(dispatch_stats[i]);
+      stats->name = name;
+      break;
+    }
+
+    if (strcmp(dispatch_stats[i].name, name) == 0) {
+      stats = &(dispatch_stats[i]);
+      break;
+    }
+  }
+
+  if (stats == NULL) {
+    errno = ENOSPC;
+    return -1;
+  }
+
+  stats->count++;
+  stats->total_nsecs += nsecs;
+  if (nsecs > stats->max_nsecs) {
+    stats->max_nsecs = nsecs;
+  }
+
+  return 0;
+}
+
+/* Formats the given nanoseconds as milliseconds, e.g. "12.345 ms". */
+static const char *stats_fmt_msecs(char *buf, size_t bufsz, uint64_t nsecs) {
+  snprintf(buf, bufsz-1, "%lu.%03lu ms", (unsigned long) (nsecs / 1000000),
+    (unsigned long) ((nsecs / 1000) % 1000));
+  buf[bufsz-1] = '\0';
+  return buf;
+}
+
+static void stats_log_hist(unsigned int shape) {
+  register unsigned int i;
+  struct sqlconf_hist *hist;
+  char buckets[1024], total[32], max[32];
+  size_t len = 0;
+
+  hist = &(query_hists[shape]);
+  if (hist->count == 0) {
+    return;
+  }
+
+  pr_trace_msg(trace_channel, 9,
+    "timing: query %s: %lu queries, %s total, %s max", query_shapes[shape],
+    (unsigned long) hist->count,
+    stats_fmt_msecs(total, sizeof(total), hist->total_nsecs),
+    stats_fmt_msecs(max, sizeof(max), hist->max_nsecs));
+
+  memset(buckets, '\0', sizeof(buckets));
+  for (i = 0; i < CONF_SQL_HIST_NBUCKETS; i++) {
+    if (hist->buckets[i] == 0) {
+      continue;
+    }
+
+    if (i < CONF_SQL_HIST_NBUCKETS - 1) {
+      len += snprintf(buckets + len, sizeof(buckets) - len - 1, " <%luus:%lu",
+        (unsigned long) 1 << i, (unsigned long) hist->buckets[i]);
+
+    } else {
+      len += snprintf(buckets + len, sizeof(buckets) - len - 1, " >=%luus:%lu",
+        (unsigned long) 1 << (i - 1), (unsigned long) hist->buckets[i]);
+    }
+  }
+
+  pr_trace_msg(trace_channel, 10, "timing: query %s histogram:%s",
+    query_shapes[shape], buckets);
+}
+
+void sqlconf_stats_log_summary(void) {
+  register unsigned int i;
+  char bufs[CONF_SQL_TIME_MAX+1][32];
+
+  for (i = 0; i <= CONF_SQL_TIME_MAX; i++) {
+    stats_fmt_msecs(bufs[i], sizeof(bufs[i]), time_nsecs[i]);
+  }
+
+  pr_log_debug(DEBUG3, MOD_CONF_SQL_VERSION
+    ": configuration loaded in %s (open %s, queries %s, render %s, close %s): "
+    "%lu queries, %lu rows, %lu bytes rendered, %lu lines read",
+    bufs[CONF_SQL_TIME_TOTAL], bufs[CONF_SQL_TIME_OPEN],
+    bufs[CONF_SQL_TIME_QUERY], bufs[CONF_SQL_TIME_RENDER],
+    bufs[CONF_SQL_TIME_CLOSE], (unsigned long) counts[CONF_SQL_COUNT_QUERIES],
+    (unsigned long) counts[CONF_SQL_COUNT_ROWS],
+    (unsigned long) counts[CONF_SQL_COUNT_BYTES],
+    (unsigned long) counts[CONF_SQL_COUNT_LINES]);
+
+  pr_trace_msg(trace_channel, 1,
+    "loaded in %s: %lu queries, %lu rows, %lu bytes rendered, %lu lines read",
+    bufs[CONF_SQL_TIME_TOTAL], (unsigned long) counts[CONF_SQL_COUNT_QUERIES],
+    (unsigned long) counts[CONF_SQL_COUNT_ROWS],
+    (unsigned long) counts[CONF_SQL_COUNT_BYTES],
+    (unsigned long) counts[CONF_SQL_COUNT_LINES]);
+
+  for (i = 0; i <= CONF_SQL_TIME_MAX; i++) {
+    pr_trace_msg(trace_channel, 8, "timing: %s: %s", time_phases[i], bufs[i]);
+  }
+
+  for (i = 0; i < CONF_SQL_STATS_MAX_HOOKS; i++) {
+    struct sqlconf_dispatch_stats *stats;
+    char total[32], max[32];
+
+    stats = &(dispatch_stats[i]);
+    if (stats->name == NULL) {
+      break;
+    }
+
+    pr_trace_msg(trace_channel, 9, "timing: %s: %lu calls, %s total, %s max",
+      stats->name, (unsigned long) stats->count,
+      stats_fmt_msecs(total, sizeof(total), stats->total_nsecs),
+      stats_fmt_msecs(max, sizeof(max), stats->max_nsecs));
+  }
+
+  for (i = 0; i <= CONF_SQL_QUERY_MAX; i++) {
+    stats_log_hist(i);
+  }
+}
+
+void sqlconf_stats_set_backend(const char *backend) {
+  load_backend = backend;
+}
+
+void sqlconf_stats_set_fallback(int fallback) {
+  load_fallback = fallback;
+}
+
+const char *sqlconf_stats_get_backend(int *fallback) {
+  if (fallback != NULL) {
+    *fallback = load_fallback;
+  }
+
+  return load_backend;
+}
+
+/* Formats the given nanoseconds as seconds, e.g. "0.012345678". */
+static const char *stats_fmt_secs(char *buf, size_t bufsz, uint64_t nsecs) {
+  snprintf(buf, bufsz-1, "%lu.%09lu", (unsigned long) (nsecs / 1000000000),
+    (unsigned long) (nsecs % 1000000000));
+  buf[bufsz-1] = '\0';
+  return buf;
+}
+
+static int stats_write_json(FILE *fh, int success) {
+  register unsigned int i;
+  char buf[64];
+
+  fprintf(fh, "{\n");
+  fprintf(fh, "  \"version\": \"%s\",\n", MOD_CONF_SQL_VERSION);
+  fprintf(fh, "  \"timestamp\": %lu,\n", (unsigned long) time(NULL));
+  fprintf(fh, "  \"success\": %s,\n", success ? "true" : "false");
+  fprintf(fh, "  \"backend\": \"%s\",\n",
+    load_backend != NULL ? load_backend : "none");
+  fprintf(fh, "  \"fallback\": %s,\n", load_fallback ? "true" : "false");
+  fprintf(fh, "  \"duration_seconds\": %s,\n",
+    stats_fmt_secs(buf, sizeof(buf), time_nsecs[CONF_SQL_TIME_TOTAL]));
+
+  fprintf(fh, "  \"phase_seconds\": {");
+  for (i = 0; i < CONF_SQL_TIME_TOTAL; i++) {
+    fprintf(fh, "%s\"%s\": %s", i > 0 ? ", " : "", time_phases[i],
+      stats_fmt_secs(buf, sizeof(buf), time_nsecs[i]));
+  }
+  fprintf(fh, "},\n");
+
+  fprintf(fh, "  \"queries\": %lu,\n",
+    (unsigned long) counts[CONF_SQL_COUNT_QUERIES]);
+  fprintf(fh, "  \"rows\": %lu,\n",
+    (unsigned long) counts[CONF_SQL_COUNT_ROWS]);
+  fprintf(fh, "  \"contexts\": %lu,\n",
+    (unsigned long) counts[CONF_SQL_COUNT_CTXS]);
+  fprintf(fh, "  \"directives\": %lu,\n",
+    (unsigned long) counts[CONF_SQL_COUNT_CONFS]);
+  fprintf(fh, "  \"bytes\": %lu,\n",
+    (unsigned long) counts[CONF_SQL_COUNT_BYTES]);
+  fprintf(fh, "  \"errors\": %lu,\n",
+    (unsigned long) counts[CONF_SQL_COUNT_ERRORS]);
+  fprintf(fh, "  \"memory_peak_bytes\": %lu,\n", (unsigned long) mem_peak);
+
+  fprintf(fh, "  \"query_shapes\": {\n");
+  for (i = 0; i <= CONF_SQL_QUERY_MAX; i++) {
+    struct sqlconf_hist *hist;
+    char max[64];
+
+    hist = &(query_hists[i]);
+    fprintf(fh, "    \"%s\": {\"count\": %lu, \"total_seconds\": %s, "
+      "\"max_seconds\": %s}%s\n", query_shapes[i], (unsigned long) hist->count,
+      stats_fmt_secs(buf, sizeof(buf), hist->total_nsecs),
+      stats_fmt_secs(max, sizeof(max), hist->max_nsecs),
+      i < CONF_SQL_QUERY_MAX ? "," : "");
+  }
+  fprintf(fh, "  }\n");
+
+  return fprintf(fh, "}\n");
+}
+
+static void stats_write_gauge(FILE *fh, const char *name, const char *help,
+    unsigned long val) {
+  fprintf(fh, "# HELP proftpd_conf_sql_%s %s\n", name, help);
+  fprintf(fh, "# TYPE proftpd_conf_sql_%s gauge\n", name);
+  fprintf(fh, "proftpd_conf_sql_%s %lu\n", name, val);
+}
+
+static int stats_write_prometheus(FILE *fh, int success) {
+  register unsigned int i, j;
+  char buf[64];
+
+  stats_write_gauge(fh, "load_success",
+    "Whether the most recent configuration load succeeded.",
+    success ? 1 : 0);
+  stats_write_gauge(fh, "load_timestamp_seconds",
+    "When the most recent configuration load finished.",
+    (unsigned long) time(NULL));
+
+  fprintf(fh, "# HELP proftpd_conf_sql_load_backend_info "
+    "The backend used for the most recent configuration load.\n");
+  fprintf(fh, "# TYPE proftpd_conf_sql_load_backend_info gauge\n");
+  fprintf(fh, "proftpd_conf_sql_load_backend_info{backend=\"%s\"} 1\n",
+    load_backend != NULL ? load_backend : "none");
+
+  stats_write_gauge(fh, "load_fallback",
+    "Whether a requested backend was unavailable, and another one used.",
+    load_fallback ? 1 : 0);
+
+  fprintf(fh, "# HELP proftpd_conf_sql_load_duration_seconds "
+    "Time spent in each phase of the most recent configuration load.\n");
+  fprintf(fh, "# TYPE proftpd_conf_sql_load_duration_seconds gauge\n");
+  for (i = 0; i <= CONF_SQL_TIME_MAX; i++) {
+    fprintf(fh, "proftpd_conf_sql_load_duration_seconds{phase=\"%s\"} %s\n",
+      time_phases[i], stats_fmt_secs(buf, sizeof(buf), time_nsecs[i]));
+  }
+
+  stats_write_gauge(fh, "load_queries", "Queries issued.",
+    (unsigned long) counts[CONF_SQL_COUNT_QUERIES]);
+  stats_write_gauge(fh, "load_rows", "Rows returned.",
+    (unsigned long) counts[CONF_SQL_COUNT_ROWS]);
+  stats_write_gauge(fh, "load_contexts", "Contexts rendered.",
+    (unsigned long) counts[CONF_SQL_COUNT_CTXS]);
+  stats_write_gauge(fh, "load_directives", "Directives rendered.",
+    (unsigned long) counts[CONF_SQL_COUNT_CONFS]);
+  stats_write_gauge(fh, "load_bytes", "Bytes of configuration rendered.",
+    (unsigned long) counts[CONF_SQL_COUNT_BYTES]);
+  stats_write_gauge(fh, "load_errors", "Database errors.",
+    (unsigned long) counts[CONF_SQL_COUNT_ERRORS]);
+  stats_write_gauge(fh, "load_memory_peak_bytes", "Peak bytes in use.",
+    (unsigned long) mem_peak);
+
+  fprintf(fh, "# HELP proftpd_conf_sql_query_duration_seconds "
+    "Latency of the queries of the most recent configuration load.\n");
+  fprintf(fh, "# TYPE proftpd_conf_sql_query_duration_seconds histogram\n");
+  for (i = 0; i <= CONF_SQL_QUERY_MAX; i++) {
+    struct sqlconf_hist *hist;
+    uint64_t cumulative = 0;
+
+    hist = &(query_hists[i]);
+    for (j = 0; j < CONF_SQL_HIST_NBUCKETS - 1; j++) {
+      cumulative += hist->buckets[j];
+      fprintf(fh, "proftpd_conf_sql_query_duration_seconds_bucket"
+        "{shape=\"%s\",le=\"%s\"} %lu\n", query_shapes[i],
+        stats_fmt_secs(buf, sizeof(buf), ((uint64_t) 1 << j) * 1000),
+        (unsigned long) cumulative);
+    }
+
+    fprintf(fh, "proftpd_conf_sql_query_duration_seconds_bucket"
+      "{shape=\"%s\",le=\"+Inf\"} %lu\n", query_shapes[i],
+      (unsigned long) hist->count);
+    fprintf(fh, "proftpd_conf_sql_query_duration_seconds_sum{shape=\"%s\"} "
+      "%s\n", query_shapes[i],
+      stats_fmt_secs(buf, sizeof(buf), hist->total_nsecs));
+    fprintf(fh, "proftpd_conf_sql_query_duration_seconds_count{shape=\"%s\"} "
+      "%lu\n", query_shapes[i], (unsigned long) hist->count);
+  }
+
+  return 0;
+}
+
+FILE *sqlconf_stats_open_tmp(pool *p, const char *path, mode_t mode,
+    char **tmp_path) {
+  char *template;
+  FILE *fh;
+  int fd, xerrno;
+
+  if (p == NULL ||
+      path == NULL ||
+      tmp_path == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  /* mkstemp(3) creates the file with O_EXCL, and mode 0600. */
+  template = pstrcat(p, path, ".XXXXXX", NULL);
+
+  fd = mkstemp(template);
+  if (fd < 0) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 3, "error creating temporary file for '%s': "
+      "%s", path, strerror(xerrno));
+    errno = xerrno;
+    return NULL;
+  }
+
+  if (fchmod(fd, mode) < 0) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 3, "error setting mode of '%s': %s", template,
+      strerror(xerrno));
+    (void) close(fd);
+    (void) unlink(template);
+    errno = xerrno;
+    return NULL;
+  }
+
+  fh = fdopen(fd, "w");
+  if (fh == NULL) {
+    xerrno = errno;
+
+    (void) close(fd);
+    (void) unlink(template);
+    errno = xerrno;
+    return NULL;
+  }
+
+  *tmp_path = template;
+  return fh;
+}
+
+int sqlconf_stats_close_tmp(FILE *fh, const char *tmp_path, const char *path,
+    int keep) {
+  int res = 0, xerrno = 0;
+
+  if (fh == NULL ||
+      tmp_path == NULL ||
+      path == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (ferror(fh)) {
+    xerrno = EIO;
+    res = -1;
+  }
+
+  if (fclose(fh) != 0 &&
+      res == 0) {
+    xerrno = errno;
+    res = -1;
+  }
+
+  if (res == 0 &&
+      keep == TRUE &&
+      rename(tmp_path, path) < 0) {
+    xerrno = errno;
+    res = -1;
+
+    pr_trace_msg(trace_channel, 3, "error renaming '%s' to '%s': %s",
+      tmp_path, path, strerror(xerrno));
+  }
+
+  if (res < 0 ||
+      keep == FALSE) {
+    (void) unlink(tmp_path);
+  }
+
+  errno = xerrno;
+  return res;
+}
+
+int sqlconf_stats_write(pool *p, const char *path, int format, int success) {
+  char *tmp_path = NULL;
+  FILE *fh;
+  int res;
+
+  if (p == NULL ||
+      path == NULL ||
+      (format != CONF_SQL_STATS_FMT_JSON &&
+       format != CONF_SQL_STATS_FMT_PROMETHEUS)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  /* Write a temporary file alongside the given path, then rename it into
+   * place, so that readers never see a partially written file.  The stats
+   * are meant for monitoring agents, and so are world-readable.
+   */
+  fh = sqlconf_stats_open_tmp(p, path, 0644, &tmp_path);
+  if (fh == NULL) {
+    return -1;
+  }
+
+  if (format == CONF_SQL_STATS_FMT_JSON) {
+    res = stats_write_json(fh, success);
+
+  } else {
+    res = stats_write_prometheus(fh, success);
+  }
+
+  if (res < 0) {
+    int xerrno = errno;
+
+    (void) sqlconf_stats_close_tmp(fh, tmp_path, path, FALSE);
+    errno = xerrno;
+    return -1;
+  }
+
+  return sqlconf_stats_close_tmp(fh, tmp_path, path, TRUE);
+}
@@ -0,0 +1,183 @@
+/*
+ * ProFTPD - mod_conf_sql statistics API
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+
+#ifndef MOD_CONF_SQL_STATS_H
+#define MOD_CONF_SQL_STATS_H
+
+/* Memory accounting phases of a configuration load. */
+#define CONF_SQL_MEM_URI		0
+#define CONF_SQL_MEM_BACKEND		1
+#define CONF_SQL_MEM_RESULTS		2
+#define CONF_SQL_MEM_LINES		3
+#define CONF_SQL_MEM_SNAPSHOT		4
+#define CONF_SQL_MEM_LOOKUP		5
+#define CONF_SQL_MEM_MAX		5
+
+/* Clears all statistics, for a new configuration load. */
+void sqlconf_stats_reset(void);
+
+/* Saves all statistics, allocated from the given pool, so that they can be
+ * restored after a read which is not a configuration load.
+ */
+struct sqlconf_stats_state;
+
+struct sqlconf_stats_state *sqlconf_stats_save(pool *p);
+int sqlconf_stats_restore(const struct sqlconf_stats_state *state);
+
+/* Records the allocation, or release, of the given number of bytes in the
+ * given phase.  Note that these are the bytes requested by mod_conf_sql,
+ * not including any pool overhead.
+ */
+int sqlconf_stats_mem_alloc(unsigned int phase, size_t len);
+int sqlconf_stats_mem_release(unsigned int phase, size_t len);
+
+/* Returns the total bytes allocated, and still in use, for the given
+ * phase.
+ */
+int sqlconf_stats_mem_get(unsigned int phase, uint64_t *allocated,
+  uint64_t *in_use);
+
+/* Returns the most bytes in use, across all phases, at any one time. */
+uint64_t sqlconf_stats_mem_peak(void);
+
+const char *sqlconf_stats_mem_phase(unsigned int phase);
+
+/* Process resource usage, sampled before and after reading the database. */
+struct sqlconf_usage {
+  /* Resident set size, and its high-water mark, in KB. */
+  long rss_kb;
+  long maxrss_kb;
+
+  long minflt;
+  long majflt;
+
+  /* User and system CPU time, in microseconds. */
+  long long utime_usecs;
+  long long stime_usecs;
+};
+
+int sqlconf_stats_usage_begin(void);
+int sqlconf_stats_usage_end(void);
+
+/* Returns the difference between the begin and end samples. */
+int sqlconf_stats_usage_get(struct sqlconf_usage *delta);
+
+/* Logs the memory and usage statistics on the conf_sql trace channel, and
+ * a one-line summary in the debug log.
+ */
+void sqlconf_stats_log_memory(void);
+
+/* Returns the current time, in nanoseconds, from a monotonic clock where
+ * available.
+ */
+uint64_t sqlconf_stats_now(void);
+
+/* Timed phases of a configuration load. */
+#define CONF_SQL_TIME_OPEN		0
+#define CONF_SQL_TIME_QUERY		1
+#define CONF_SQL_TIME_RENDER		2
+#define CONF_SQL_TIME_CLOSE		3
+#define CONF_SQL_TIME_TOTAL		4
+#define CONF_SQL_TIME_MAX		4
+
+int sqlconf_stats_time_add(unsigned int phase, uint64_t nsecs);
+int sqlconf_stats_time_get(unsigned int phase, uint64_t *nsecs);
+
+/* Counters of a configuration load. */
+#define CONF_SQL_COUNT_QUERIES		0
+#define CONF_SQL_COUNT_ROWS		1
+#define CONF_SQL_COUNT_BYTES		2
+#define CONF_SQL_COUNT_LINES		3
+#define CONF_SQL_COUNT_CTXS		4
+#define CONF_SQL_COUNT_CONFS		5
+#define CONF_SQL_COUNT_ERRORS		6
+#define CONF_SQL_COUNT_MAX		6
+
+int sqlconf_stats_count_add(unsigned int counter, uint64_t n);
+int sqlconf_stats_count_get(unsigned int counter, uint64_t *n);
+
+/* Query latencies are kept, per query shape, in a histogram of power-of-two
+ * microsecond buckets: bucket i counts latencies under 2^i microseconds, and
+ * the last bucket counts all longer latencies.
+ */
+#define CONF_SQL_HIST_NBUCKETS		20
+
+struct sqlconf_hist {
+  uint64_t count;
+  uint64_t total_nsecs;
+  uint64_t max_nsecs;
+  uint64_t buckets[CONF_SQL_HIST_NBUCKETS];
+};
+
+/* Records a query of the given shape, and its latency; the query is also
+ * counted, and its time added to the query phase.
+ */
+int sqlconf_stats_query_add(unsigned int shape, uint64_t nsecs);
+int sqlconf_stats_query_get(unsigned int shape, struct sqlconf_hist *hist);
+
+/* Records the latency of a call to the given mod_sql hook. */
+int sqlconf_stats_dispatch_add(const char *name, uint64_t nsecs);
+
+/* Logs a one-line summary of the timings and counters, and, at higher trace
+ * levels, the per-hook timings and per-shape latency histograms.
+ */
+void sqlconf_stats_log_summary(void);
+
+/* Records the backend used for the load, and whether it was used as a
+ * fallback for a requested, but unavailable, backend.
+ */
+void sqlconf_stats_set_backend(const char *backend);
+void sqlconf_stats_set_fallback(int fallback);
+
+/* Returns the backend used for the most recent load, or NULL if none, and
+ * whether it was a fallback.
+ */
+const char *sqlconf_stats_get_backend(int *fallback);
+
+/* Formats for writing the statistics of a load to a file. */
+#define CONF_SQL_STATS_FMT_JSON		1
+#define CONF_SQL_STATS_FMT_PROMETHEUS	2
+
+/* Opens a new temporary file, alongside the given path, with the given
+ * mode, for writing that file atomically.  The temporary file has a unique,
+ * unpredictable name, and is created exclusively, so that it cannot be a
+ * pre-existing file or symlink.
+ */
+FILE *sqlconf_stats_open_tmp(pool *p, const char *path, mode_t mode,
+  char **tmp_path);
+
+/* Closes the given temporary file, and, if keeping it and it was written
+ * without error, renames it to the given path; otherwise, it is removed.
+ */
+int sqlconf_stats_close_tmp(FILE *fh, const char *tmp_path, const char *path,
+  int keep);
+
+/* Atomically replaces the given file with the statistics of the most recent
+ * load, in the given format.
+ */
+int sqlconf_stats_write(pool *p, const char *path, int format, int success);
+
+#endif /* MOD_CONF_SQL_STATS_H */
@@ -0,0 +1,367 @@
+/*
+ * ProFTPD - mod_conf_sql testsuite
+ * Copyright (c) 2016 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* JSON API tests. */
+
+#include "tests.h"
+
+static pool *p = NULL;
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = make_sub_pool(NULL);
+  }
+}
+
+static void tear_down(void) {
+  if (p) {
+    destroy_pool(p);
+    p = NULL;
+  } 
+}
+
+/* Records the walker's events as lines, as they would be rendered. */
+static int walk_open_ctx(pool *tmp_pool, void *user_data, const char *type,
+    const char *value) {
+  array_header *events = user_data;
+
+  *((char **) push_array(events)) = pstrcat(p, "<", type,
+    value != NULL ? " " : "", value != NULL ? value : "", ">", NULL);
+  return 0;
+}
+
+static int walk_close_ctx(pool *tmp_pool, void *user_data, const char *type) {
+  array_header *events = user_data;
+
+  *((char **) push_array(events)) = pstrcat(p, "</", type, ">", NULL);
+  return 0;
+}
+
+static int walk_add_conf(pool *tmp_pool, void *user_data, const char *name,
+    const char *text, array_header *args) {
+  register unsigned int i;
+  array_header *events = user_data;
+  char *event;
+
+  if (strcmp(name, "Fail") == 0) {
+    errno = EPERM;
+    return -1;
+  }
+
+  event = pstrdup(p, name);
+
+  if (args != NULL) {
+    char **elts = args->elts;
+
+    for (i = 0; i < args->nelts; i++) {
+      event = pstrcat(p, event, " [", elts[i], "]", NULL);
+    }
+
+  } else {
+    event = pstrcat(p, event, " ", text, NULL);
+  }
+
+  *((char **) push_array(events)) = event;
+  return 0;
+}
+
+static const struct sqlconf_json_walker walker = {
+  walk_open_ctx,
+  walk_close_ctx,
+  walk_add_conf
+};
+
+static void assert_walk(const char *text, const char *expected[]) {
+  register unsigned int i;
+  int res;
+  array_header *events;
+  char **elts;
+
+  events = make_array(p, 0, sizeof(char *));
+
+  mark_point();
+  res = sqlconf_json_walk_conf(p, text, strlen(text), &walker, events);
+  fail_unless(res == 0, "Failed to walk '%s': %s", text, strerror(errno));
+
+  elts = events->elts;
+  for (i = 0; expected[i] != NULL; i++) {
+    fail_unless(i < events->nelts, "Expected event '%s' for '%s', got none",
+      expected[i], text);
+    fail_unless(strcmp(elts[i], expected[i]) == 0,
+      "Expected event '%s' for '%s', got '%s'", expected[i], text, elts[i]);
+  }
+
+  fail_unless(events->nelts == i, "Expected %u events for '%s', got %u", i,
+    text, events->nelts);
+}
+
+static void assert_walk_error(const char *text, int xerrno) {
+  int res;
+  array_header *events;
+
+  events = make_array(p, 0, sizeof(char *));
+
+  mark_point();
+  res = sqlconf_json_walk_conf(p, text, strlen(text), &walker, events);
+  fail_unless(res < 0, "Failed to handle invalid document '%s'", text);
+  fail_unless(errno == xerrno, "Expected %s (%d) for '%s', got %s (%d)",
+    strerror(xerrno), xerrno, text, strerror(errno), errno);
+}
+
+START_TEST (json_parse_strings_test) {
+  int res;
+  const char *text;
+  char **elts, *expected;
+  array_header *strs = NULL;
+
+  mark_point();
+  res = sqlconf_json_parse_strings(NULL, NULL, 0, NULL);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_json_parse_strings(p, NULL, 0, NULL);
+  fail_unless(res < 0, "Failed to handle null text");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  text = "[]";
+
+  mark_point();
+  res = sqlconf_json_parse_strings(p, text, strlen(text), NULL);
+  fail_unless(res < 0, "Failed to handle null strs");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_json_parse_strings(p, text, strlen(text), &strs);
+  fail_unless(res == 0, "Failed to parse '%s': %s", text, strerror(errno));
+  fail_unless(strs != NULL, "Expected array, got null");
+  fail_unless(strs->nelts == 0, "Expected 0 elements, got %u", strs->nelts);
+
+  text = " [ \"foo\", \"bar baz\" ,7,true ] ";
+
+  mark_point();
+  res = sqlconf_json_parse_strings(p, text, strlen(text), &strs);
+  fail_unless(res == 0, "Failed to parse '%s': %s", text, strerror(errno));
+  fail_unless(strs->nelts == 4, "Expected 4 elements, got %u", strs->nelts);
+
+  elts = strs->elts;
+  expected = "foo";
+  fail_unless(strcmp(elts[0], expected) == 0, "Expected '%s', got '%s'",
+    expected, elts[0]);
+  expected = "bar baz";
+  fail_unless(strcmp(elts[1], expected) == 0, "Expected '%s', got '%s'",
+    expected, elts[1]);
+  expected = "7";
+  fail_unless(strcmp(elts[2], expected) == 0, "Expected '%s', got '%s'",
+    expected, elts[2]);
+  expected = "true";
+  fail_unless(strcmp(elts[3], expected) == 0, "Expected '%s', got '%s'",
+    expected, elts[3]);
+
+  text = "[\"a \\\"quoted\\\" \\\\ value\", \"tab\\there\", \"\\u00e9\\ud83d\\ude00\"]";
+
+  mark_point();
+  res = sqlconf_json_parse_strings(p, text, strlen(text), &strs);
+  fail_unless(res == 0, "Failed to parse '%s': %s", text, strerror(errno));
+  fail_unless(strs->nelts == 3, "Expected 3 elements, got %u", strs->nelts);
+
+  elts = strs->elts;
+  expected = "a \"quoted\" \\ value";
+  fail_unless(strcmp(elts[0], expected) == 0, "Expected '%s', got '%s'",
+    expected, elts[0]);
+  expected = "tab\there";
+  fail_unless(strcmp(elts[1], expected) == 0, "Expected '%s', got '%s'",
+    expected, elts[1]);
+  expected = "\xc3\xa9\xf0\x9f\x98\x80";
+  fail_unless(strcmp(elts[2], expected) == 0, "Expected '%s', got '%s'",
+    expected, elts[2]);
+
+  /* Malformed arrays. */
+  text = "\"foo\"";
+
+  mark_point();
+  res = sqlconf_json_parse_strings(p, text, strlen(text), &strs);
+  fail_unless(res < 0, "Failed to handle invalid JSON '%s'", text);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  text = "[\"foo\"";
+
+  mark_point();
+  res = sqlconf_json_parse_strings(p, text, strlen(text), &strs);
+  fail_unless(res < 0, "Failed to handle invalid JSON '%s'", text);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  text = "[\"foo]";
+
+  mark_point();
+  res = sqlconf_json_parse_strings(p, text, strlen(text), &strs);
+  fail_unless(res < 0, "Failed to handle invalid JSON '%s'", text);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  text = "[[\"foo\"]]";
+
+  mark_point();
+  res = sqlconf_json_parse_strings(p, text, strlen(text), &strs);
+  fail_unless(res < 0, "Failed to handle invalid JSON '%s'", text);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  text = "[\"foo\"] x";
+
+  mark_point();
+  res = sqlconf_json_parse_strings(p, text, strlen(text), &strs);
+  fail_unless(res < 0, "Failed to handle invalid JSON '%s'", text);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  text = "[\"\\ud83d\"]";
+
+  mark_point();
+  res = sqlconf_json_parse_strings(p, text, strlen(text), &strs);
+  fail_unless(res < 0, "Failed to handle invalid JSON '%s'", text);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+}
+END_TEST
+
+START_TEST (json_walk_conf_test) {
+  register unsigned int i;
+  int res;
+  char *text;
+
+  const char *list_events[] = {
+    "ServerName \"Test\"",
+    "<VirtualHost 127.0.0.1>",
+    "Port 2121",
+    "<Directory /tmp>",
+    "AllowUser [bob] [alice]",
+    "</Directory>",
+    "</VirtualHost>",
+    "<Global>",
+    "</Global>",
+    NULL
+  };
+
+  const char *ctx_events[] = {
+    "<Anonymous ~ftp>",
+    "User ftp",
+    "</Anonymous>",
+    NULL
+  };
+
+  const char *value_events[] = {
+    "<IfModule>",
+    "<Limit 1>",
+    "</Limit>",
+    "</IfModule>",
+    NULL
+  };
+
+  const char *empty_events[] = {
+    NULL
+  };
+
+  mark_point();
+  res = sqlconf_json_walk_conf(NULL, NULL, 0, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_json_walk_conf(p, "[]", 2, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null walker");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  assert_walk("[\"ServerName \\\"Test\\\"\", "
+    "{\"type\": \"VirtualHost\", \"value\": \"127.0.0.1\", "
+    "\"config\": [\"  Port 2121 \", {\"type\": \"Directory\", "
+    "\"value\": \"/tmp\", \"config\": [[\"AllowUser\", \"bob\", "
+    "\"alice\"]]}]}, {\"type\": \"Global\", \"value\": null}]",
+    list_events);
+
+  /* The config list may come before the type, and unknown keys are
+   * ignored.
+   */
+  assert_walk("{\"config\": [\"User ftp\"], \"comment\": {\"a\": [1, "
+    "\"]\"]}, \"type\": \"Anonymous\", \"value\": \"~ftp\"}",
+    ctx_events);
+
+  assert_walk("{\"type\": \"IfModule\", \"config\": [{\"type\": "
+    "\"Limit\", \"value\": 1}]}", value_events);
+  assert_walk(" [ ] ", empty_events);
+
+  assert_walk_error("", EINVAL);
+  assert_walk_error("\"Port 2121\"", EINVAL);
+  assert_walk_error("[\"Port 2121\"", EINVAL);
+  assert_walk_error("[\"Port 2121\"] x", EINVAL);
+  assert_walk_error("[\"  \"]", EINVAL);
+  assert_walk_error("[1]", EINVAL);
+  assert_walk_error("[[]]", EINVAL);
+  assert_walk_error("[[\"AllowUser\", [\"bob\"]]]", EINVAL);
+  assert_walk_error("[{\"value\": \"/tmp\"}]", EINVAL);
+  assert_walk_error("[{\"type\": \"Global\", \"type\": \"Global\"}]",
+    EINVAL);
+  assert_walk_error("[{\"type\": \"Global\", \"config\": {}}]", EINVAL);
+  assert_walk_error("[{\"type\": \"Global\"", EINVAL);
+
+  /* Errors from the callbacks are passed on. */
+  assert_walk_error("[{\"type\": \"Global\", \"config\": [\"Fail\"]}]",
+    EPERM);
+
+  /* Contexts nested too deeply. */
+  text = "";
+  for (i = 0; i <= CONF_SQL_JSON_MAX_DEPTH; i++) {
+    text = pstrcat(p, text, "{\"type\": \"Global\", \"config\": [", NULL);
+  }
+
+  for (i = 0; i <= CONF_SQL_JSON_MAX_DEPTH; i++) {
+    text = pstrcat(p, text, "]}", NULL);
+  }
+
+  assert_walk_error(text, EINVAL);
+}
+END_TEST
+
+Suite *tests_get_json_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("json");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, json_parse_strings_test);
+  tcase_add_test(testcase, json_walk_conf_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
@@ -0,0 +1,419 @@
+/*
+ * ProFTPD - mod_conf_sql testsuite
+ * Copyright (c) 2016 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+/* Lookup API tests. */
+
+#include "tests.h"
+
+static pool *p = NULL;
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = make_sub_pool(NULL);
+  }
+}
+
+static void tear_down(void) {
+  sqlconf_lookup_use(NULL);
+
+  if (p) {
+    destroy_pool(p);
+    p = NULL;
+  }
+}
+
+/* Builds the equivalent of:
+ *
+ *  ServerName "Test Server"
+ *  <VirtualHost 127.0.0.1>
+ *    Port 2121
+ *    <Directory /var/ftp>
+ *      HideFiles ^\.
+ *    </Directory>
+ *  </VirtualHost>
+ *  <Global>
+ *    AllowOverwrite on
+ *  </Global>
+ */
+static sqlconf_lookup_t *create_lookup(void) {
+  sqlconf_lookup_t *lookup;
+  char *argv[2];
+
+  lookup = sqlconf_lookup_create(p);
+  fail_unless(lookup != NULL, "Failed to create lookup: %s", strerror(errno));
+
+  fail_unless(sqlconf_lookup_open_ctx(lookup, "default", NULL) == 0,
+    "Failed to open root context: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_add_conf_text(lookup, "ServerName",
+    "\"Test Server\"") == 0, "Failed to add directive: %s", strerror(errno));
+
+  fail_unless(sqlconf_lookup_open_ctx(lookup, "VirtualHost", "127.0.0.1") == 1,
+    "Failed to open context: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_add_conf_text(lookup, "Port", "2121") == 0,
+    "Failed to add directive: %s", strerror(errno));
+
+  fail_unless(sqlconf_lookup_open_ctx(lookup, "Directory", "/var/ftp") == 2,
+    "Failed to open context: %s", strerror(errno));
+  argv[0] = "^\\.";
+  fail_unless(sqlconf_lookup_add_conf(lookup, "HideFiles", 1, argv) == 0,
+    "Failed to add directive: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_close_ctx(lookup) == 0,
+    "Failed to close context: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_close_ctx(lookup) == 0,
+    "Failed to close context: %s", strerror(errno));
+
+  fail_unless(sqlconf_lookup_open_ctx(lookup, "Global", NULL) == 3,
+    "Failed to open context: %s", strerror(errno));
+  argv[0] = "on";
+  fail_unless(sqlconf_lookup_add_conf(lookup, "AllowOverwrite", 1, argv) == 0,
+    "Failed to add directive: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_close_ctx(lookup) == 0,
+    "Failed to close context: %s", strerror(errno));
+
+  fail_unless(sqlconf_lookup_close_ctx(lookup) == 0,
+    "Failed to close root context: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_finish(lookup) == 0,
+    "Failed to finish lookup: %s", strerror(errno));
+
+  return lookup;
+}
+
+START_TEST (lookup_build_test) {
+  sqlconf_lookup_t *lookup;
+  int res;
+
+  mark_point();
+  lookup = sqlconf_lookup_create(NULL);
+  fail_unless(lookup == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  lookup = sqlconf_lookup_create(p);
+  fail_unless(lookup != NULL, "Failed to create lookup: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_get_size(lookup) == 0, "Expected empty lookup");
+
+  mark_point();
+  res = sqlconf_lookup_add_conf_text(lookup, "Port", "21");
+  fail_unless(res < 0, "Failed to handle directive without context");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_lookup_close_ctx(lookup);
+  fail_unless(res < 0, "Failed to handle close without context");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  res = sqlconf_lookup_open_ctx(lookup, "default", NULL);
+  fail_unless(res == 0, "Failed to open root context: %s", strerror(errno));
+
+  res = sqlconf_lookup_open_ctx(lookup, "Global", NULL);
+  fail_unless(res == 1, "Failed to open context: %s", strerror(errno));
+
+  res = sqlconf_lookup_close_ctx(lookup);
+  fail_unless(res == 0, "Failed to close context: %s", strerror(errno));
+
+  /* Directives may follow a child context. */
+  mark_point();
+  res = sqlconf_lookup_add_conf_text(lookup, "Port", "21");
+  fail_unless(res == 0, "Failed to add directive after child context: %s",
+    strerror(errno));
+
+  res = sqlconf_lookup_close_ctx(lookup);
+  fail_unless(res == 0, "Failed to close root context: %s", strerror(errno));
+
+  mark_point();
+  res = sqlconf_lookup_open_ctx(lookup, "default", NULL);
+  fail_unless(res < 0, "Failed to handle second root context");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  fail_unless(sqlconf_lookup_get_size(lookup) > 0, "Expected non-empty lookup");
+  sqlconf_lookup_destroy(lookup);
+}
+END_TEST
+
+START_TEST (lookup_ctx_test) {
+  int res, parent_idx = 0;
+  const char *type = NULL, *value = NULL;
+
+  mark_point();
+  res = conf_sql_lookup_ctx(CONF_SQL_LOOKUP_ROOT, "");
+  fail_unless(res < 0, "Failed to handle missing lookup");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  sqlconf_lookup_use(create_lookup());
+
+  mark_point();
+  res = conf_sql_lookup_ctx(CONF_SQL_LOOKUP_ROOT, NULL);
+  fail_unless(res < 0, "Failed to handle null path");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = conf_sql_lookup_ctx(CONF_SQL_LOOKUP_ROOT, "");
+  fail_unless(res == CONF_SQL_LOOKUP_ROOT, "Expected root context, got %d",
+    res);
+
+  res = conf_sql_lookup_ctx(CONF_SQL_LOOKUP_ROOT,
+    "<virtualhost 127.0.0.1> <Directory  /var/ftp >");
+  fail_unless(res == 2, "Expected context 2, got %d (%s)", res,
+    strerror(errno));
+
+  res = conf_sql_lookup_ctx(1, "<Directory /var/ftp>");
+  fail_unless(res == 2, "Expected context 2, got %d (%s)", res,
+    strerror(errno));
+
+  mark_point();
+  res = conf_sql_lookup_ctx(CONF_SQL_LOOKUP_ROOT, "<Directory /var/ftp>");
+  fail_unless(res < 0, "Failed to handle non-child context");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  res = conf_sql_lookup_ctx(CONF_SQL_LOOKUP_ROOT, "<Global");
+  fail_unless(res < 0, "Failed to handle malformed path");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = conf_sql_lookup_ctx_info(2, &type, &value, &parent_idx);
+  fail_unless(res == 0, "Failed to get context info: %s", strerror(errno));
+  fail_unless(strcmp(type, "Directory") == 0, "Expected 'Directory', got '%s'",
+    type);
+  fail_unless(strcmp(value, "/var/ftp") == 0, "Expected '/var/ftp', got '%s'",
+    value);
+  fail_unless(parent_idx == 1, "Expected parent 1, got %d", parent_idx);
+
+  res = conf_sql_lookup_ctx_info(CONF_SQL_LOOKUP_ROOT, NULL, NULL,
+    &parent_idx);
+  fail_unless(res == 0, "Failed to get context info: %s", strerror(errno));
+  fail_unless(parent_idx == -1, "Expected no parent, got %d", parent_idx);
+
+  mark_point();
+  res = conf_sql_lookup_ctx_info(4, NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle unknown context");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+}
+END_TEST
+
+START_TEST (lookup_ctx_child_test) {
+  int res;
+
+  sqlconf_lookup_use(create_lookup());
+
+  res = conf_sql_lookup_ctx_child(CONF_SQL_LOOKUP_ROOT, -1);
+  fail_unless(res == 1, "Expected child 1, got %d (%s)", res, strerror(errno));
+
+  res = conf_sql_lookup_ctx_child(CONF_SQL_LOOKUP_ROOT, res);
+  fail_unless(res == 3, "Expected child 3, got %d (%s)", res, strerror(errno));
+
+  mark_point();
+  res = conf_sql_lookup_ctx_child(CONF_SQL_LOOKUP_ROOT, res);
+  fail_unless(res < 0, "Failed to handle end of children");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  res = conf_sql_lookup_ctx_child(CONF_SQL_LOOKUP_ROOT, 2);
+  fail_unless(res < 0, "Failed to handle non-child previous context");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = conf_sql_lookup_ctx_child(2, -1);
+  fail_unless(res < 0, "Failed to handle context without children");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+}
+END_TEST
+
+START_TEST (lookup_conf_test) {
+  int res, conf_idx;
+  const char *name = NULL;
+  unsigned int argc = 0;
+  const char * const *argv = NULL;
+
+  sqlconf_lookup_use(create_lookup());
+
+  conf_idx = conf_sql_lookup_conf(CONF_SQL_LOOKUP_ROOT, "servername", -1);
+  fail_unless(conf_idx >= 0, "Failed to find ServerName: %s",
+    strerror(errno));
+
+  res = conf_sql_lookup_conf_info(conf_idx, &name, &argc, &argv);
+  fail_unless(res == 0, "Failed to get directive info: %s", strerror(errno));
+  fail_unless(strcmp(name, "ServerName") == 0,
+    "Expected 'ServerName', got '%s'", name);
+  fail_unless(argc == 1, "Expected 1 argument, got %u", argc);
+  fail_unless(strcmp(argv[0], "Test Server") == 0,
+    "Expected 'Test Server', got '%s'", argv[0]);
+
+  mark_point();
+  res = conf_sql_lookup_conf(CONF_SQL_LOOKUP_ROOT, "ServerName", conf_idx);
+  fail_unless(res < 0, "Failed to handle end of directives");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  res = conf_sql_lookup_conf(CONF_SQL_LOOKUP_ROOT, "Port", -1);
+  fail_unless(res < 0, "Failed to handle directive of child context");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  conf_idx = conf_sql_lookup_conf(2, NULL, -1);
+  fail_unless(conf_idx >= 0, "Failed to find directive: %s", strerror(errno));
+
+  res = conf_sql_lookup_conf_info(conf_idx, &name, &argc, &argv);
+  fail_unless(res == 0, "Failed to get directive info: %s", strerror(errno));
+  fail_unless(strcmp(name, "HideFiles") == 0, "Expected 'HideFiles', got '%s'",
+    name);
+  fail_unless(argc == 1, "Expected 1 argument, got %u", argc);
+  fail_unless(strcmp(argv[0], "^\\.") == 0, "Expected '^\\.', got '%s'",
+    argv[0]);
+
+  mark_point();
+  res = conf_sql_lookup_conf(1, NULL, conf_idx);
+  fail_unless(res < 0, "Failed to handle directive of another context");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = conf_sql_lookup_conf_info(100, NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle unknown directive");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+}
+END_TEST
+
+/* Builds the equivalent of:
+ *
+ *  ServerName "Test Server"
+ *  <VirtualHost 127.0.0.1>
+ *    Port 2121
+ *    <Directory /var/ftp>
+ *      HideFiles ^\.
+ *    </Directory>
+ *    MaxClients 10
+ *  </VirtualHost>
+ *  AllowOverwrite on
+ *
+ * with directives following child contexts, as a view or a JSON document
+ * may render them.
+ */
+START_TEST (lookup_unordered_test) {
+  sqlconf_lookup_t *lookup;
+  int ctx_idx, conf_idx, res;
+  const char *name;
+  const char *expected[] = { "ServerName", "AllowOverwrite", NULL };
+  register unsigned int i;
+
+  lookup = sqlconf_lookup_create(p);
+  fail_unless(lookup != NULL, "Failed to create lookup: %s", strerror(errno));
+
+  fail_unless(sqlconf_lookup_open_ctx(lookup, "default", NULL) == 0,
+    "Failed to open root context: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_add_conf_text(lookup, "ServerName",
+    "\"Test Server\"") == 0, "Failed to add directive: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_open_ctx(lookup, "VirtualHost", "127.0.0.1") == 1,
+    "Failed to open context: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_add_conf_text(lookup, "Port", "2121") == 0,
+    "Failed to add directive: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_open_ctx(lookup, "Directory", "/var/ftp") == 2,
+    "Failed to open context: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_add_conf_text(lookup, "HideFiles", "^\\.") == 0,
+    "Failed to add directive: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_close_ctx(lookup) == 0,
+    "Failed to close context: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_add_conf_text(lookup, "MaxClients", "10") == 0,
+    "Failed to add directive: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_close_ctx(lookup) == 0,
+    "Failed to close context: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_add_conf_text(lookup, "AllowOverwrite",
+    "on") == 0, "Failed to add directive: %s", strerror(errno));
+  fail_unless(sqlconf_lookup_close_ctx(lookup) == 0,
+    "Failed to close root context: %s", strerror(errno));
+
+  mark_point();
+  res = sqlconf_lookup_finish(lookup);
+  fail_unless(res == 0, "Failed to finish lookup: %s", strerror(errno));
+  sqlconf_lookup_use(lookup);
+
+  /* Each context's directives are found, in the order added. */
+  conf_idx = -1;
+  for (i = 0; expected[i] != NULL; i++) {
+    conf_idx = conf_sql_lookup_conf(CONF_SQL_LOOKUP_ROOT, NULL, conf_idx);
+    fail_unless(conf_idx >= 0, "Failed to find '%s': %s", expected[i],
+      strerror(errno));
+
+    res = conf_sql_lookup_conf_info(conf_idx, &name, NULL, NULL);
+    fail_unless(res == 0, "Failed to get directive: %s", strerror(errno));
+    fail_unless(strcmp(name, expected[i]) == 0, "Expected '%s', got '%s'",
+      expected[i], name);
+  }
+
+  res = conf_sql_lookup_conf(CONF_SQL_LOOKUP_ROOT, NULL, conf_idx);
+  fail_unless(res < 0, "Expected no more root directives, got %d", res);
+
+  ctx_idx = conf_sql_lookup_ctx(CONF_SQL_LOOKUP_ROOT,
+    "<VirtualHost 127.0.0.1>");
+  fail_unless(ctx_idx == 1, "Expected context 1, got %d", ctx_idx);
+
+  conf_idx = conf_sql_lookup_conf(ctx_idx, "MaxClients", -1);
+  fail_unless(conf_idx >= 0, "Failed to find 'MaxClients': %s",
+    strerror(errno));
+  conf_idx = conf_sql_lookup_conf(ctx_idx, "HideFiles", -1);
+  fail_unless(conf_idx < 0, "Found 'HideFiles' outside of its context");
+
+  ctx_idx = conf_sql_lookup_ctx(CONF_SQL_LOOKUP_ROOT,
+    "<VirtualHost 127.0.0.1><Directory /var/ftp>");
+  fail_unless(ctx_idx == 2, "Expected context 2, got %d", ctx_idx);
+
+  conf_idx = conf_sql_lookup_conf(ctx_idx, NULL, -1);
+  fail_unless(conf_idx >= 0, "Failed to find directive: %s", strerror(errno));
+  res = conf_sql_lookup_conf_info(conf_idx, &name, NULL, NULL);
+  fail_unless(res == 0, "Failed to get directive: %s", strerror(errno));
+  fail_unless(strcmp(name, "HideFiles") == 0, "Expected 'HideFiles', got '%s'",
+    name);
+}
+END_TEST
+
+Suite *tests_get_lookup_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("lookup");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, lookup_build_test);
+  tcase_add_test(testcase, lookup_ctx_test);
+  tcase_add_test(testcase, lookup_ctx_child_test);
+  tcase_add_test(testcase, lookup_conf_test);
+  tcase_add_test(testcase, lookup_unordered_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
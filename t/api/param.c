@@ -41,6 +41,128 @@ static void tear_down(void) {
   } 
 }
 
+START_TEST (param_parse_table_test) {
+  int res;
+  const char *param;
+  pr_table_t *params;
+  struct sqlconf_param_cols cols;
+  struct sqlconf_param_spec spec = {
+    "tbl", "my_tbl", 3, 2, { "a", "b", "c" }
+  };
+
+  params = pr_table_alloc(p, 0);
+
+  mark_point();
+  res = sqlconf_param_parse_table(NULL, NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_param_parse_table(p, params, &spec, NULL);
+  fail_unless(res < 0, "Failed to handle null cols");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* Optional columns may be omitted, and defaults filled in. */
+  param = "t:x,y:where=z%3D1";
+  pr_table_add(params, pstrdup(p, "tbl"), pstrdup(p, param), 0);
+
+  mark_point();
+  res = sqlconf_param_parse_table(p, params, &spec, &cols);
+  fail_unless(res == 0, "Failed to parse '%s': %s", param, strerror(errno));
+  fail_unless(strcmp(cols.table, "t") == 0, "Expected 't', got '%s'",
+    cols.table);
+  fail_unless(strcmp(cols.cols[0], "x") == 0, "Expected 'x', got '%s'",
+    cols.cols[0]);
+  fail_unless(strcmp(cols.cols[1], "y") == 0, "Expected 'y', got '%s'",
+    cols.cols[1]);
+  fail_unless(cols.cols[2] == NULL, "Expected null, got '%s'", cols.cols[2]);
+  fail_unless(strcmp(cols.where, "z=1") == 0,
+    "Expected 'z=1', got '%s'", cols.where);
+
+  sqlconf_param_set_defaults(&spec, &cols);
+  fail_unless(strcmp(cols.cols[2], "c") == 0, "Expected 'c', got '%s'",
+    cols.cols[2]);
+
+  /* Values added without their NUL, as from a URI, are used in full. */
+  pr_table_empty(params);
+  param = "t";
+  pr_table_add(params, pstrdup(p, "tbl"), pstrdup(p, param), 1);
+
+  mark_point();
+  res = sqlconf_param_parse_table(p, params, &spec, &cols);
+  fail_unless(res == 0, "Failed to parse '%s': %s", param, strerror(errno));
+  fail_unless(strcmp(cols.table, "t") == 0, "Expected 't', got '%s'",
+    cols.table);
+
+  sqlconf_param_set_defaults(&spec, &cols);
+  fail_unless(strcmp(cols.cols[0], "a") == 0, "Expected 'a', got '%s'",
+    cols.cols[0]);
+
+  pr_table_empty(params);
+  param = "t:x,y,z,w";
+  pr_table_add(params, pstrdup(p, "tbl"), pstrdup(p, param), 0);
+
+  mark_point();
+  res = sqlconf_param_parse_table(p, params, &spec, &cols);
+  fail_unless(res < 0, "Failed to handle too many columns in '%s'", param);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+  fail_unless(cols.table == NULL, "Expected null, got '%s'", cols.table);
+
+  pr_table_empty(params);
+  param = "t:x,,z";
+  pr_table_add(params, pstrdup(p, "tbl"), pstrdup(p, param), 0);
+
+  mark_point();
+  res = sqlconf_param_parse_table(p, params, &spec, &cols);
+  fail_unless(res < 0, "Failed to handle empty column in '%s'", param);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  pr_table_empty(params);
+  param = "t:x,y:wher";
+  pr_table_add(params, pstrdup(p, "tbl"), pstrdup(p, param), 0);
+
+  mark_point();
+  res = sqlconf_param_parse_table(p, params, &spec, &cols);
+  fail_unless(res < 0, "Failed to handle bad WHERE clause in '%s'", param);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  pr_table_empty(params);
+  param = "t:x,y:where=";
+  pr_table_add(params, pstrdup(p, "tbl"), pstrdup(p, param), 0);
+
+  mark_point();
+  res = sqlconf_param_parse_table(p, params, &spec, &cols);
+  fail_unless(res < 0, "Failed to handle empty WHERE clause in '%s'", param);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* Set-returning functions can be named in place of a view. */
+  pr_table_empty(params);
+  param = "ftpconf_ctx_lines(2)";
+  pr_table_add(params, pstrdup(p, "view"), pstrdup(p, param), 0);
+
+  mark_point();
+  res = sqlconf_param_parse_table(p, params, &sqlconf_param_view_spec, &cols);
+  fail_unless(res == 0, "Failed to parse '%s': %s", param, strerror(errno));
+  fail_unless(strcmp(cols.table, param) == 0, "Expected '%s', got '%s'",
+    param, cols.table);
+
+  sqlconf_param_set_defaults(&sqlconf_param_view_spec, &cols);
+  fail_unless(strcmp(cols.cols[CONF_SQL_VIEW_COL_SEQ], "seq") == 0,
+    "Expected 'seq', got '%s'", cols.cols[CONF_SQL_VIEW_COL_SEQ]);
+  fail_unless(strcmp(cols.cols[CONF_SQL_VIEW_COL_LINE], "line") == 0,
+    "Expected 'line', got '%s'", cols.cols[CONF_SQL_VIEW_COL_LINE]);
+
+  pr_table_empty(params);
+  pr_table_free(params);
+}
+END_TEST
+
 /* Expected format of the conf parameter:
  *
  *   conf=<table>[:id,name,value][:where=<clause>]
@@ -167,7 +289,7 @@ START_TEST (param_parse_conf_test) {
   fail_unless(name_col == NULL, "Expected null, got name_col '%s'", name_col);
   fail_unless(value_col == NULL, "Expected null, got value_col '%s'",
     value_col);
-  expected = "WHERE=bar";
+  expected = "bar";
   fail_unless(where != NULL, "Expected where, got null");
   fail_unless(strcmp(where, expected) == 0, "Expected '%s', got '%s'",
     expected, where);
@@ -228,7 +350,7 @@ START_TEST (param_parse_conf_test) {
   fail_unless(value_col != NULL, "Expected value_col, got null");
   fail_unless(strcmp(value_col, expected) == 0, "Expected '%s', got '%s'",
     expected, value_col);
-  expected = "WHERE=barbaz";
+  expected = "barbaz";
   fail_unless(where != NULL, "Expected where, got null");
   fail_unless(strcmp(where, expected) == 0, "Expected '%s', got '%s'",
     expected, where);
@@ -266,7 +388,7 @@ START_TEST (param_parse_conf_test) {
   fail_unless(value_col != NULL, "Expected value_col, got null");
   fail_unless(strcmp(value_col, expected) == 0, "Expected '%s', got '%s'",
     expected, value_col);
-  expected = "WHERE=foo = 1 AND bar = 'baz'";
+  expected = "foo = 1 AND bar = 'baz'";
   fail_unless(where != NULL, "Expected where, got null");
   fail_unless(strcmp(where, expected) == 0, "Expected '%s', got '%s'",
     expected, where);
@@ -449,7 +571,7 @@ START_TEST (param_parse_ctx_test) {
   fail_unless(type_col == NULL, "Expected null, got type_col '%s'", type_col);
   fail_unless(value_col == NULL, "Expected null, got value_col '%s'",
     value_col);
-  expected = "WHERE=bar";
+  expected = "bar";
   fail_unless(where != NULL, "Expected where, got null");
   fail_unless(strcmp(where, expected) == 0, "Expected '%s', got '%s'",
     expected, where);
@@ -518,7 +640,7 @@ START_TEST (param_parse_ctx_test) {
   fail_unless(value_col != NULL, "Expected value_col, got null");
   fail_unless(strcmp(value_col, expected) == 0, "Expected '%s', got '%s'",
     expected, value_col);
-  expected = "WHERE=barbaz";
+  expected = "barbaz";
   fail_unless(where != NULL, "Expected where, got null");
   fail_unless(strcmp(where, expected) == 0, "Expected '%s', got '%s'",
     expected, where);
@@ -560,7 +682,7 @@ START_TEST (param_parse_ctx_test) {
   fail_unless(value_col != NULL, "Expected value_col, got null");
   fail_unless(strcmp(value_col, expected) == 0, "Expected '%s', got '%s'",
     expected, value_col);
-  expected = "WHERE=foo = 1 AND bar = 'baz'";
+  expected = "foo = 1 AND bar = 'baz'";
   fail_unless(where != NULL, "Expected where, got null");
   fail_unless(strcmp(where, expected) == 0, "Expected '%s', got '%s'",
     expected, where);
@@ -719,7 +841,7 @@ START_TEST (param_parse_map_test) {
     conf_id_col);
   fail_unless(ctx_id_col == NULL, "Expected null, got ctx_id_col '%s'",
     ctx_id_col);
-  expected = "WHERE=foo";
+  expected = "foo";
   fail_unless(where != NULL, "Expected where, got null");
   fail_unless(strcmp(where, expected) == 0, "Expected '%s', got '%s'",
     expected, where);
@@ -772,7 +894,7 @@ START_TEST (param_parse_map_test) {
   fail_unless(ctx_id_col != NULL, "Expected ctx_id_col, got null");
   fail_unless(strcmp(ctx_id_col, expected) == 0, "Expected '%s', got '%s'",
     expected, ctx_id_col);
-  expected = "WHERE=foo";
+  expected = "foo";
   fail_unless(where != NULL, "Expected where, got null");
   fail_unless(strcmp(where, expected) == 0, "Expected '%s', got '%s'",
     expected, where);
@@ -805,7 +927,7 @@ START_TEST (param_parse_map_test) {
   fail_unless(ctx_id_col != NULL, "Expected ctx_id_col, got null");
   fail_unless(strcmp(ctx_id_col, expected) == 0, "Expected '%s', got '%s'",
     expected, ctx_id_col);
-  expected = "WHERE=foo = 1 AND bar = 'baz'";
+  expected = "foo = 1 AND bar = 'baz'";
   fail_unless(where != NULL, "Expected where, got null");
   fail_unless(strcmp(where, expected) == 0, "Expected '%s', got '%s'",
     expected, where);
@@ -844,6 +966,138 @@ START_TEST (param_parse_map_test) {
 }
 END_TEST
 
+/* Expected format of the argv parameter:
+ *
+ *   argv=<column>[:<separator>]
+ */
+START_TEST (param_parse_argv_test) {
+  int res;
+  char *argv_col, *separator, *param, *expected;
+  pr_table_t *params;
+
+  mark_point();
+  res = sqlconf_param_parse_argv(NULL, NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_param_parse_argv(p, NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null params");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  params = pr_table_alloc(p, 1);
+
+  mark_point();
+  res = sqlconf_param_parse_argv(p, params, &argv_col, NULL);
+  fail_unless(res < 0, "Failed to handle null separator");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* No "argv" parameter. */
+  mark_point();
+  res = sqlconf_param_parse_argv(p, params, &argv_col, &separator);
+  fail_unless(res == 0, "Failed to parse argv param: %s", strerror(errno));
+  fail_unless(argv_col == NULL, "Expected null, got argv_col '%s'", argv_col);
+  fail_unless(separator == NULL, "Expected null, got separator '%s'",
+    separator);
+
+  /* "argv" parameter with just the column name. */
+  pr_table_empty(params);
+
+  param = "args";
+  pr_table_add(params, pstrdup(p, "argv"), pstrdup(p, param), 0);
+
+  mark_point();
+  res = sqlconf_param_parse_argv(p, params, &argv_col, &separator);
+  fail_unless(res == 0, "Failed to parse argv param: %s", strerror(errno));
+  expected = "args";
+  fail_unless(argv_col != NULL, "Expected argv_col, got null");
+  fail_unless(strcmp(argv_col, expected) == 0, "Expected '%s', got '%s'",
+    expected, argv_col);
+  fail_unless(separator == NULL, "Expected null, got separator '%s'",
+    separator);
+
+  /* "argv" parameter with a URL-encoded separator. */
+  pr_table_empty(params);
+
+  param = "args:%09";
+  pr_table_add(params, pstrdup(p, "argv"), pstrdup(p, param), 0);
+
+  mark_point();
+  res = sqlconf_param_parse_argv(p, params, &argv_col, &separator);
+  fail_unless(res == 0, "Failed to parse argv param: %s", strerror(errno));
+  expected = "args";
+  fail_unless(argv_col != NULL, "Expected argv_col, got null");
+  fail_unless(strcmp(argv_col, expected) == 0, "Expected '%s', got '%s'",
+    expected, argv_col);
+  expected = "\t";
+  fail_unless(separator != NULL, "Expected separator, got null");
+  fail_unless(strcmp(separator, expected) == 0, "Expected '%s', got '%s'",
+    expected, separator);
+
+  /* Values added without their NUL, as from a URI, are used in full. */
+  pr_table_empty(params);
+
+  param = "a";
+  pr_table_add(params, pstrdup(p, "argv"), pstrdup(p, param), strlen(param));
+
+  mark_point();
+  res = sqlconf_param_parse_argv(p, params, &argv_col, &separator);
+  fail_unless(res == 0, "Failed to parse argv param: %s", strerror(errno));
+  expected = "a";
+  fail_unless(argv_col != NULL, "Expected argv_col, got null");
+  fail_unless(strcmp(argv_col, expected) == 0, "Expected '%s', got '%s'",
+    expected, argv_col);
+  fail_unless(separator == NULL, "Expected null, got separator '%s'",
+    separator);
+
+  pr_table_empty(params);
+
+  param = "a:%09";
+  pr_table_add(params, pstrdup(p, "argv"), pstrdup(p, param), strlen(param));
+
+  mark_point();
+  res = sqlconf_param_parse_argv(p, params, &argv_col, &separator);
+  fail_unless(res == 0, "Failed to parse argv param: %s", strerror(errno));
+  expected = "a";
+  fail_unless(argv_col != NULL, "Expected argv_col, got null");
+  fail_unless(strcmp(argv_col, expected) == 0, "Expected '%s', got '%s'",
+    expected, argv_col);
+  expected = "\t";
+  fail_unless(separator != NULL, "Expected separator, got null");
+  fail_unless(strcmp(separator, expected) == 0, "Expected '%s', got '%s'",
+    expected, separator);
+
+  /* Malformed "argv" parameters. */
+  pr_table_empty(params);
+
+  param = ":|";
+  pr_table_add(params, pstrdup(p, "argv"), pstrdup(p, param), 0);
+
+  mark_point();
+  res = sqlconf_param_parse_argv(p, params, &argv_col, &separator);
+  fail_unless(res < 0, "Failed to handle invalid argv param '%s'", param);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  pr_table_empty(params);
+
+  param = "args:||";
+  pr_table_add(params, pstrdup(p, "argv"), pstrdup(p, param), 0);
+
+  mark_point();
+  res = sqlconf_param_parse_argv(p, params, &argv_col, &separator);
+  fail_unless(res < 0, "Failed to handle invalid argv param '%s'", param);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  pr_table_empty(params);
+  pr_table_free(params);
+}
+END_TEST
+
 Suite *tests_get_param_suite(void) {
   Suite *suite;
   TCase *testcase;
@@ -853,9 +1107,11 @@ Suite *tests_get_param_suite(void) {
 
   tcase_add_checked_fixture(testcase, set_up, tear_down);
 
+  tcase_add_test(testcase, param_parse_table_test);
   tcase_add_test(testcase, param_parse_conf_test);
   tcase_add_test(testcase, param_parse_ctx_test);
   tcase_add_test(testcase, param_parse_map_test);
+  tcase_add_test(testcase, param_parse_argv_test);
 
   suite_add_tcase(suite, testcase);
   return suite;
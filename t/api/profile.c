@@ -0,0 +1,239 @@
+/*
+ * ProFTPD - mod_conf_sql testsuite
+ * Copyright (c) 2016 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+/* Profile API tests. */
+
+#include "tests.h"
+
+static pool *p = NULL;
+
+static const char *profile_path = "/tmp/mod_conf_sql-profile.folded";
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = make_sub_pool(NULL);
+  }
+}
+
+static void tear_down(void) {
+  sqlconf_profile_stop();
+  (void) unlink(profile_path);
+
+  if (p) {
+    destroy_pool(p);
+    p = NULL;
+  }
+}
+
+static char *read_file(const char *path) {
+  FILE *fh;
+  char *text;
+  size_t len;
+
+  fh = fopen(path, "r");
+  if (fh == NULL) {
+    return NULL;
+  }
+
+  text = pcalloc(p, 16384);
+  len = fread(text, 1, 16383, fh);
+  text[len] = '\0';
+  fclose(fh);
+
+  return text;
+}
+
+START_TEST (profile_start_test) {
+  int res;
+
+  mark_point();
+  res = sqlconf_profile_start(NULL);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_profile_enter();
+  fail_unless(res < 0, "Failed to handle unstarted profile");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_profile_query(1);
+  fail_unless(res < 0, "Failed to handle unstarted profile");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_profile_write(profile_path, CONF_SQL_PROFILE_METRIC_TIME);
+  fail_unless(res < 0, "Failed to handle unstarted profile");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  res = sqlconf_profile_start(p);
+  fail_unless(res == 0, "Failed to start profile: %s", strerror(errno));
+
+  mark_point();
+  res = sqlconf_profile_exit();
+  fail_unless(res < 0, "Failed to handle exit without enter");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_profile_write(profile_path, 0);
+  fail_unless(res < 0, "Failed to handle invalid metric");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+}
+END_TEST
+
+START_TEST (profile_write_test) {
+  int res;
+  char *text;
+
+  res = sqlconf_profile_start(p);
+  fail_unless(res == 0, "Failed to start profile: %s", strerror(errno));
+
+  /* server
+   *   VirtualHost 10.0.0.5 (2 queries)
+   *     Directory /srv/x (3 queries, visited twice)
+   *   Limit; (not rendered)
+   */
+  (void) sqlconf_profile_enter();
+  (void) sqlconf_profile_query(1);
+  (void) sqlconf_profile_set_frame("server", NULL);
+
+  (void) sqlconf_profile_enter();
+  (void) sqlconf_profile_query(1);
+  (void) sqlconf_profile_set_frame("VirtualHost", "10.0.0.5");
+  (void) sqlconf_profile_query(4);
+
+  (void) sqlconf_profile_enter();
+  (void) sqlconf_profile_set_frame("Directory", "/srv/x");
+  (void) sqlconf_profile_query(2);
+  (void) sqlconf_profile_exit();
+
+  (void) sqlconf_profile_enter();
+  (void) sqlconf_profile_set_frame("Directory", "/srv/x");
+  (void) sqlconf_profile_query(1);
+  (void) sqlconf_profile_query(1);
+  (void) sqlconf_profile_exit();
+
+  (void) sqlconf_profile_exit();
+
+  /* Contexts without a frame are charged to their parent. */
+  (void) sqlconf_profile_enter();
+  (void) sqlconf_profile_query(0);
+  (void) sqlconf_profile_exit();
+
+  res = sqlconf_profile_exit();
+  fail_unless(res == 0, "Failed to exit: %s", strerror(errno));
+
+  mark_point();
+  res = sqlconf_profile_write(profile_path, CONF_SQL_PROFILE_METRIC_QUERIES);
+  fail_unless(res == 0, "Failed to write profile: %s", strerror(errno));
+
+  text = read_file(profile_path);
+  fail_unless(text != NULL, "Failed to read '%s': %s", profile_path,
+    strerror(errno));
+  fail_unless(strcmp(text,
+    "server 2\n"
+    "server;VirtualHost 10.0.0.5 2\n"
+    "server;VirtualHost 10.0.0.5;Directory /srv/x 3\n") == 0,
+    "Unexpected profile '%s'", text);
+
+  mark_point();
+  res = sqlconf_profile_write(profile_path, CONF_SQL_PROFILE_METRIC_ROWS);
+  fail_unless(res == 0, "Failed to write profile: %s", strerror(errno));
+
+  text = read_file(profile_path);
+  fail_unless(text != NULL, "Failed to read '%s': %s", profile_path,
+    strerror(errno));
+  fail_unless(strcmp(text,
+    "server 1\n"
+    "server;VirtualHost 10.0.0.5 5\n"
+    "server;VirtualHost 10.0.0.5;Directory /srv/x 4\n") == 0,
+    "Unexpected profile '%s'", text);
+
+  mark_point();
+  res = sqlconf_profile_write(profile_path, CONF_SQL_PROFILE_METRIC_TIME);
+  fail_unless(res == 0, "Failed to write profile: %s", strerror(errno));
+}
+END_TEST
+
+START_TEST (profile_frame_test) {
+  int res;
+  char *text;
+
+  res = sqlconf_profile_start(p);
+  fail_unless(res == 0, "Failed to start profile: %s", strerror(errno));
+
+  mark_point();
+  res = sqlconf_profile_set_frame("server", NULL);
+  fail_unless(res < 0, "Failed to handle frame without enter");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  (void) sqlconf_profile_enter();
+
+  mark_point();
+  res = sqlconf_profile_set_frame(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null type");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* Semicolons separate frames, so must not appear within one. */
+  res = sqlconf_profile_set_frame("IfDefine", "A;B\n");
+  fail_unless(res == 0, "Failed to set frame: %s", strerror(errno));
+  (void) sqlconf_profile_query(1);
+  (void) sqlconf_profile_exit();
+
+  res = sqlconf_profile_write(profile_path, CONF_SQL_PROFILE_METRIC_QUERIES);
+  fail_unless(res == 0, "Failed to write profile: %s", strerror(errno));
+
+  text = read_file(profile_path);
+  fail_unless(text != NULL, "Failed to read '%s': %s", profile_path,
+    strerror(errno));
+  fail_unless(strcmp(text, "IfDefine A_B_ 1\n") == 0,
+    "Unexpected profile '%s'", text);
+}
+END_TEST
+
+Suite *tests_get_profile_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("profile");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, profile_start_test);
+  tcase_add_test(testcase, profile_write_test);
+  tcase_add_test(testcase, profile_frame_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
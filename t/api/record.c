@@ -0,0 +1,379 @@
+/*
+ * ProFTPD - mod_conf_sql testsuite
+ * Copyright (c) 2016 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+/* Record/replay API tests. */
+
+#include "tests.h"
+
+static pool *p = NULL;
+
+static const char *record_path = "/tmp/mod_conf_sql-record.bin";
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = make_sub_pool(NULL);
+  }
+}
+
+static void tear_down(void) {
+  sqlconf_replay_stop();
+  (void) unlink(record_path);
+
+  if (p) {
+    destroy_pool(p);
+    p = NULL;
+  }
+}
+
+static sql_data_t *make_results(unsigned long rnum, unsigned long fnum,
+    ...) {
+  register unsigned long i;
+  sql_data_t *sd;
+  va_list args;
+
+  sd = pcalloc(p, sizeof(sql_data_t));
+  sd->rnum = rnum;
+  sd->fnum = fnum;
+  sd->data = pcalloc(p, sizeof(char *) * (rnum * fnum + 1));
+
+  va_start(args, fnum);
+  for (i = 0; i < rnum * fnum; i++) {
+    sd->data[i] = va_arg(args, char *);
+  }
+  va_end(args);
+
+  return sd;
+}
+
+static int write_file(const char *path, const char *data, size_t datalen) {
+  FILE *fh;
+
+  fh = fopen(path, "w");
+  if (fh == NULL) {
+    return -1;
+  }
+
+  if (datalen > 0) {
+    fwrite(data, datalen, 1, fh);
+  }
+
+  return fclose(fh);
+}
+
+START_TEST (record_start_test) {
+  int res;
+  sql_data_t *sd;
+
+  mark_point();
+  res = sqlconf_record_start(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_record_start(p, NULL);
+  fail_unless(res < 0, "Failed to handle null path");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  sd = make_results(0, 0);
+
+  mark_point();
+  res = sqlconf_record_add("id FROM ftpctx", 0, sd);
+  fail_unless(res < 0, "Failed to handle unstarted recording");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_record_stop(TRUE);
+  fail_unless(res < 0, "Failed to handle unstarted recording");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_record_start(p, "/no/such/dir/record.bin");
+  fail_unless(res < 0, "Failed to handle bad path");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_record_start(p, record_path);
+  fail_unless(res == 0, "Failed to start recording: %s", strerror(errno));
+
+  mark_point();
+  res = sqlconf_record_start(p, record_path);
+  fail_unless(res < 0, "Failed to handle recording already started");
+  fail_unless(errno == EEXIST, "Expected EEXIST (%d), got %s (%d)", EEXIST,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_record_add(NULL, 0, sd);
+  fail_unless(res < 0, "Failed to handle null query");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_record_add("id FROM ftpctx", 0, NULL);
+  fail_unless(res < 0, "Failed to handle null results");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* Recordings which are not kept leave no file behind. */
+  mark_point();
+  res = sqlconf_record_stop(FALSE);
+  fail_unless(res == 0, "Failed to stop recording: %s", strerror(errno));
+  fail_unless(access(record_path, F_OK) < 0, "Unexpectedly kept recording");
+}
+END_TEST
+
+START_TEST (record_replay_test) {
+  int res;
+  sql_data_t *sd;
+  struct stat st;
+
+  mark_point();
+  res = sqlconf_record_start(p, record_path);
+  fail_unless(res == 0, "Failed to start recording: %s", strerror(errno));
+
+  sd = make_results(1, 1, "1");
+  res = sqlconf_record_add("id FROM ftpctx WHERE parent_id IS NULL", 1500,
+    sd);
+  fail_unless(res == 0, "Failed to record query: %s", strerror(errno));
+
+  sd = make_results(2, 2, "ServerName", "\"Test\"", "Umask", NULL);
+  res = sqlconf_record_add("name, value FROM ftpconf WHERE id = 1", 2500, sd);
+  fail_unless(res == 0, "Failed to record query: %s", strerror(errno));
+
+  sd = make_results(0, 1);
+  res = sqlconf_record_add("id FROM ftpctx WHERE parent_id = 1", 500, sd);
+  fail_unless(res == 0, "Failed to record query: %s", strerror(errno));
+
+  /* Later results for the same query are ignored. */
+  sd = make_results(1, 1, "2");
+  res = sqlconf_record_add("id FROM ftpctx WHERE parent_id IS NULL", 100, sd);
+  fail_unless(res == 0, "Failed to record query: %s", strerror(errno));
+
+  mark_point();
+  res = sqlconf_record_stop(TRUE);
+  fail_unless(res == 0, "Failed to stop recording: %s", strerror(errno));
+
+  /* Recordings may hold credentials, and so are readable only by their
+   * owner.
+   */
+  fail_unless(stat(record_path, &st) == 0, "Failed to stat '%s': %s",
+    record_path, strerror(errno));
+  fail_unless((st.st_mode & 0777) == 0600, "Expected mode 0600, got %04o",
+    (unsigned int) (st.st_mode & 0777));
+
+  mark_point();
+  res = sqlconf_replay_select(p, "id FROM ftpctx", &sd);
+  fail_unless(res < 0, "Failed to handle unstarted replay");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_replay_start(p, record_path, -1, 0);
+  fail_unless(res < 0, "Failed to handle bad latency");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_replay_start(p, record_path, CONF_SQL_REPLAY_LATENCY_NONE, 0);
+  fail_unless(res == 0, "Failed to start replay: %s", strerror(errno));
+
+  mark_point();
+  res = sqlconf_replay_select(p, NULL, &sd);
+  fail_unless(res < 0, "Failed to handle null query");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_replay_select(p, "id FROM ftpctx WHERE parent_id = 2", &sd);
+  fail_unless(res < 0, "Failed to handle unrecorded query");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  sd = NULL;
+  res = sqlconf_replay_select(p, "id FROM ftpctx WHERE parent_id IS NULL",
+    &sd);
+  fail_unless(res == 0, "Failed to replay query: %s", strerror(errno));
+  fail_unless(sd->rnum == 1, "Expected 1 row, got %lu", sd->rnum);
+  fail_unless(sd->fnum == 1, "Expected 1 field, got %lu", sd->fnum);
+  fail_unless(strcmp(sd->data[0], "1") == 0, "Expected '1', got '%s'",
+    sd->data[0]);
+
+  mark_point();
+  sd = NULL;
+  res = sqlconf_replay_select(p, "name, value FROM ftpconf WHERE id = 1", &sd);
+  fail_unless(res == 0, "Failed to replay query: %s", strerror(errno));
+  fail_unless(sd->rnum == 2, "Expected 2 rows, got %lu", sd->rnum);
+  fail_unless(sd->fnum == 2, "Expected 2 fields, got %lu", sd->fnum);
+  fail_unless(strcmp(sd->data[0], "ServerName") == 0,
+    "Expected 'ServerName', got '%s'", sd->data[0]);
+  fail_unless(strcmp(sd->data[1], "\"Test\"") == 0,
+    "Expected '\"Test\"', got '%s'", sd->data[1]);
+  fail_unless(strcmp(sd->data[2], "Umask") == 0,
+    "Expected 'Umask', got '%s'", sd->data[2]);
+  fail_unless(sd->data[3] == NULL, "Expected NULL, got '%s'", sd->data[3]);
+
+  mark_point();
+  sd = NULL;
+  res = sqlconf_replay_select(p, "id FROM ftpctx WHERE parent_id = 1", &sd);
+  fail_unless(res == 0, "Failed to replay query: %s", strerror(errno));
+  fail_unless(sd->rnum == 0, "Expected 0 rows, got %lu", sd->rnum);
+
+  mark_point();
+  res = sqlconf_replay_start(p, record_path, CONF_SQL_REPLAY_LATENCY_NONE, 0);
+  fail_unless(res < 0, "Failed to handle replay already started");
+  fail_unless(errno == EEXIST, "Expected EEXIST (%d), got %s (%d)", EEXIST,
+    strerror(errno), errno);
+
+  sqlconf_replay_stop();
+}
+END_TEST
+
+START_TEST (record_replay_latency_test) {
+  int res;
+  sql_data_t *sd;
+  struct timeval start, end;
+  long elapsed_usecs;
+
+  res = sqlconf_record_start(p, record_path);
+  fail_unless(res == 0, "Failed to start recording: %s", strerror(errno));
+
+  sd = make_results(1, 1, "1");
+  res = sqlconf_record_add("id FROM ftpctx WHERE parent_id IS NULL",
+    20 * 1000 * 1000, sd);
+  fail_unless(res == 0, "Failed to record query: %s", strerror(errno));
+
+  res = sqlconf_record_stop(TRUE);
+  fail_unless(res == 0, "Failed to stop recording: %s", strerror(errno));
+
+  mark_point();
+  res = sqlconf_replay_start(p, record_path,
+    CONF_SQL_REPLAY_LATENCY_RECORDED, 0);
+  fail_unless(res == 0, "Failed to start replay: %s", strerror(errno));
+
+  gettimeofday(&start, NULL);
+  res = sqlconf_replay_select(p, "id FROM ftpctx WHERE parent_id IS NULL",
+    &sd);
+  gettimeofday(&end, NULL);
+  fail_unless(res == 0, "Failed to replay query: %s", strerror(errno));
+
+  elapsed_usecs = ((end.tv_sec - start.tv_sec) * 1000000L) +
+    (end.tv_usec - start.tv_usec);
+  fail_unless(elapsed_usecs >= 20000,
+    "Expected at least 20000 usecs of latency, got %ld", elapsed_usecs);
+
+  sqlconf_replay_stop();
+
+  mark_point();
+  res = sqlconf_replay_start(p, record_path, CONF_SQL_REPLAY_LATENCY_FIXED,
+    10000);
+  fail_unless(res == 0, "Failed to start replay: %s", strerror(errno));
+
+  gettimeofday(&start, NULL);
+  res = sqlconf_replay_select(p, "id FROM ftpctx WHERE parent_id IS NULL",
+    &sd);
+  gettimeofday(&end, NULL);
+  fail_unless(res == 0, "Failed to replay query: %s", strerror(errno));
+
+  elapsed_usecs = ((end.tv_sec - start.tv_sec) * 1000000L) +
+    (end.tv_usec - start.tv_usec);
+  fail_unless(elapsed_usecs >= 10000,
+    "Expected at least 10000 usecs of latency, got %ld", elapsed_usecs);
+}
+END_TEST
+
+START_TEST (record_replay_malformed_test) {
+  int res;
+  sql_data_t *sd;
+
+  mark_point();
+  res = sqlconf_replay_start(p, "/no/such/record.bin",
+    CONF_SQL_REPLAY_LATENCY_NONE, 0);
+  fail_unless(res < 0, "Failed to handle missing recording");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  write_file(record_path, "", 0);
+  res = sqlconf_replay_start(p, record_path, CONF_SQL_REPLAY_LATENCY_NONE, 0);
+  fail_unless(res < 0, "Failed to handle empty recording");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  write_file(record_path, "ServerName \"Test\"\n", 18);
+  res = sqlconf_replay_start(p, record_path, CONF_SQL_REPLAY_LATENCY_NONE, 0);
+  fail_unless(res < 0, "Failed to handle non-recording");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* A header alone is an empty recording. */
+  mark_point();
+  write_file(record_path, "CSQLREC\001", 8);
+  res = sqlconf_replay_start(p, record_path, CONF_SQL_REPLAY_LATENCY_NONE, 0);
+  fail_unless(res == 0, "Failed to start replay: %s", strerror(errno));
+  sqlconf_replay_stop();
+
+  /* A truncated entry, claiming a 2-byte query of one row of 0x7fffffff
+   * fields.
+   */
+  mark_point();
+  write_file(record_path,
+    "CSQLREC\001\0\0\0\002id\0\0\0\0\0\0\0\0\0\0\0\001\177\377\377\377",
+    30);
+  res = sqlconf_replay_start(p, record_path, CONF_SQL_REPLAY_LATENCY_NONE, 0);
+  fail_unless(res < 0, "Failed to handle truncated recording");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_replay_select(p, "id", &sd);
+  fail_unless(res < 0, "Failed to handle failed replay");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+}
+END_TEST
+
+Suite *tests_get_record_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("record");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, record_start_test);
+  tcase_add_test(testcase, record_replay_test);
+  tcase_add_test(testcase, record_replay_latency_test);
+  tcase_add_test(testcase, record_replay_malformed_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
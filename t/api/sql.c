@@ -0,0 +1,499 @@
+/*
+ * ProFTPD - mod_conf_sql testsuite
+ * Copyright (c) 2016 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* Fake mod_sql, serving the default configuration tables from memory, for
+ * testing the module's reading of them.  Its hooks are registered in the
+ * symbol stash, as those of mod_sql are, and the calls to each are counted.
+ */
+
+#include "tests.h"
+#include "mod_sql.h"
+
+#define SQL_HOOK_LOAD_BACKEND		0
+#define SQL_HOOK_PREPARE		1
+#define SQL_HOOK_DEFINE_CONN		2
+#define SQL_HOOK_OPEN_CONN		3
+#define SQL_HOOK_SELECT			4
+#define SQL_HOOK_CLOSE_CONN		5
+#define SQL_HOOK_CLEANUP		6
+#define SQL_HOOK_MAX			6
+
+struct sql_ctx {
+  int id;
+  int parent_id;
+  const char *type;
+  const char *value;
+};
+
+struct sql_conf {
+  int id;
+  const char *name;
+  const char *value;
+};
+
+struct sql_map {
+  int conf_id;
+  int ctx_id;
+};
+
+struct sql_doc {
+  int id;
+  const char *doc;
+};
+
+static pool *sql_pool = NULL;
+static array_header *sql_ctxs = NULL, *sql_confs = NULL, *sql_maps = NULL;
+static array_header *sql_docs = NULL;
+static unsigned long sql_nrows = 0;
+
+static struct {
+  unsigned long ncalls;
+  int fail;
+} sql_hook_info[SQL_HOOK_MAX+1];
+
+static modret_t *sql_call(cmd_rec *cmd, unsigned int hook) {
+  sql_hook_info[hook].ncalls++;
+
+  if (sql_hook_info[hook].fail == TRUE) {
+    return PR_ERROR_MSG(cmd, NULL, "fake failure");
+  }
+
+  return PR_HANDLED(cmd);
+}
+
+static modret_t *sql_load_backend(cmd_rec *cmd) {
+  return sql_call(cmd, SQL_HOOK_LOAD_BACKEND);
+}
+
+static modret_t *sql_prepare(cmd_rec *cmd) {
+  return sql_call(cmd, SQL_HOOK_PREPARE);
+}
+
+static modret_t *sql_define_conn(cmd_rec *cmd) {
+  return sql_call(cmd, SQL_HOOK_DEFINE_CONN);
+}
+
+static modret_t *sql_open_conn(cmd_rec *cmd) {
+  return sql_call(cmd, SQL_HOOK_OPEN_CONN);
+}
+
+static modret_t *sql_close_conn(cmd_rec *cmd) {
+  return sql_call(cmd, SQL_HOOK_CLOSE_CONN);
+}
+
+static modret_t *sql_cleanup(cmd_rec *cmd) {
+  return sql_call(cmd, SQL_HOOK_CLEANUP);
+}
+
+static char *sql_itoa(pool *p, int i) {
+  char buf[32];
+
+  snprintf(buf, sizeof(buf)-1, "%d", i);
+  buf[sizeof(buf)-1] = '\0';
+  return pstrdup(p, buf);
+}
+
+static void sql_add_row(array_header *rows, const char *val1,
+    const char *val2) {
+  *((const char **) push_array(rows)) = val1;
+  if (val2 != NULL) {
+    *((const char **) push_array(rows)) = val2;
+  }
+}
+
+/* Renders the lines of the given context, and of its children, as the
+ * reference ftpconf_lines view does; the root context is not wrapped.
+ */
+static void sql_render_ctx(pool *p, array_header *rows, struct sql_ctx *ctx) {
+  register unsigned int i, j;
+  struct sql_ctx *ctxs = sql_ctxs->elts;
+  struct sql_conf *confs = sql_confs->elts;
+  struct sql_map *maps = sql_maps->elts;
+
+  if (ctx->parent_id != 0) {
+    sql_add_row(rows, pstrcat(p, "<", ctx->type,
+      ctx->value != NULL ? " " : "", ctx->value != NULL ? ctx->value : "",
+      ">", NULL), NULL);
+  }
+
+  for (i = 0; i < sql_maps->nelts; i++) {
+    if (maps[i].ctx_id != ctx->id) {
+      continue;
+    }
+
+    for (j = 0; j < sql_confs->nelts; j++) {
+      if (confs[j].id == maps[i].conf_id) {
+        sql_add_row(rows, pstrcat(p, confs[j].name, " ", confs[j].value,
+          NULL), NULL);
+      }
+    }
+  }
+
+  for (i = 0; i < sql_ctxs->nelts; i++) {
+    if (ctxs[i].parent_id == ctx->id) {
+      sql_render_ctx(p, rows, &(ctxs[i]));
+    }
+  }
+
+  if (ctx->parent_id != 0) {
+    sql_add_row(rows, pstrcat(p, "</", ctx->type, ">", NULL), NULL);
+  }
+}
+
+/* Answers the queries for the default table and column names; any other
+ * query is an error.
+ */
+static modret_t *sql_select(cmd_rec *cmd) {
+  register unsigned int i, j;
+  modret_t *mr;
+  const char *query;
+  array_header *rows;
+  sql_data_t *sd;
+  int id, len = 0;
+
+  mr = sql_call(cmd, SQL_HOOK_SELECT);
+  if (MODRET_ISERROR(mr)) {
+    return mr;
+  }
+
+  query = cmd->argv[1];
+  rows = make_array(cmd->tmp_pool, 0, sizeof(char *));
+
+  sd = pcalloc(cmd->tmp_pool, sizeof(sql_data_t));
+
+  if (strcmp(query, "id FROM ftpctx WHERE parent_id IS NULL") == 0) {
+    struct sql_ctx *ctxs = sql_ctxs->elts;
+
+    sd->fnum = 1;
+    for (i = 0; i < sql_ctxs->nelts; i++) {
+      if (ctxs[i].parent_id == 0) {
+        sql_add_row(rows, sql_itoa(cmd->tmp_pool, ctxs[i].id), NULL);
+      }
+    }
+
+  } else if (sscanf(query, "id FROM ftpctx WHERE id = %d", &id) == 1) {
+    struct sql_ctx *ctxs = sql_ctxs->elts;
+
+    sd->fnum = 1;
+    for (i = 0; i < sql_ctxs->nelts; i++) {
+      if (ctxs[i].id == id) {
+        sql_add_row(rows, sql_itoa(cmd->tmp_pool, ctxs[i].id), NULL);
+      }
+    }
+
+  } else if (sscanf(query, "id FROM ftpctx WHERE parent_id = %d", &id) == 1) {
+    struct sql_ctx *ctxs = sql_ctxs->elts;
+
+    sd->fnum = 1;
+    for (i = 0; i < sql_ctxs->nelts; i++) {
+      if (ctxs[i].parent_id == id) {
+        sql_add_row(rows, sql_itoa(cmd->tmp_pool, ctxs[i].id), NULL);
+      }
+    }
+
+  } else if (sscanf(query, "type, value FROM ftpctx WHERE id = %d",
+      &id) == 1) {
+    struct sql_ctx *ctxs = sql_ctxs->elts;
+
+    sd->fnum = 2;
+    for (i = 0; i < sql_ctxs->nelts; i++) {
+      if (ctxs[i].id == id) {
+        sql_add_row(rows, ctxs[i].type,
+          ctxs[i].value != NULL ? ctxs[i].value : "");
+      }
+    }
+
+  } else if (sscanf(query, "name, value FROM ftpconf INNER JOIN ftpmap "
+      "ON ftpconf.id = ftpmap.conf_id WHERE ftpmap.ctx_id = %d", &id) == 1) {
+    struct sql_conf *confs = sql_confs->elts;
+    struct sql_map *maps = sql_maps->elts;
+
+    sd->fnum = 2;
+    for (i = 0; i < sql_maps->nelts; i++) {
+      if (maps[i].ctx_id != id) {
+        continue;
+      }
+
+      for (j = 0; j < sql_confs->nelts; j++) {
+        if (confs[j].id == maps[i].conf_id) {
+          sql_add_row(rows, confs[j].name, confs[j].value);
+        }
+      }
+    }
+
+  } else if (strcmp(query, "line FROM ftpconf_lines ORDER BY seq") == 0) {
+    struct sql_ctx *ctxs = sql_ctxs->elts;
+
+    sd->fnum = 1;
+    for (i = 0; i < sql_ctxs->nelts; i++) {
+      if (ctxs[i].parent_id == 0) {
+        sql_render_ctx(cmd->tmp_pool, rows, &(ctxs[i]));
+      }
+    }
+
+  } else if (sscanf(query, "line FROM ftpconf_lines WHERE seq > %d "
+      "ORDER BY seq%n", &id, &len) == 1 &&
+      query[len] == '\0') {
+    struct sql_ctx *ctxs = sql_ctxs->elts;
+    array_header *lines;
+
+    /* The lines are numbered from 1, in the order rendered. */
+    lines = make_array(cmd->tmp_pool, 0, sizeof(char *));
+    for (i = 0; i < sql_ctxs->nelts; i++) {
+      if (ctxs[i].parent_id == 0) {
+        sql_render_ctx(cmd->tmp_pool, lines, &(ctxs[i]));
+      }
+    }
+
+    sd->fnum = 1;
+    for (i = 0; i < lines->nelts; i++) {
+      if (i + 1 > (unsigned int) id) {
+        sql_add_row(rows, ((char **) lines->elts)[i], NULL);
+      }
+    }
+
+  } else if (strcmp(query, "doc FROM ftpdoc") == 0) {
+    struct sql_doc *docs = sql_docs->elts;
+
+    sd->fnum = 1;
+    for (i = 0; i < sql_docs->nelts; i++) {
+      sql_add_row(rows, docs[i].doc, NULL);
+    }
+
+  } else if (sscanf(query, "doc FROM ftpdoc WHERE id = %d", &id) == 1) {
+    struct sql_doc *docs = sql_docs->elts;
+
+    sd->fnum = 1;
+    for (i = 0; i < sql_docs->nelts; i++) {
+      if (docs[i].id == id) {
+        sql_add_row(rows, docs[i].doc, NULL);
+      }
+    }
+
+  } else {
+    return PR_ERROR_MSG(cmd, NULL, pstrcat(cmd->tmp_pool,
+      "unsupported query: ", query, NULL));
+  }
+
+  sd->rnum = rows->nelts / sd->fnum;
+  sd->data = rows->elts;
+  sql_nrows += sd->rnum;
+
+  return mod_create_data(cmd, sd);
+}
+
+static module sql_module = {
+  NULL, NULL,
+
+  /* Module API version 2.0 */
+  0x20,
+
+  /* Module name */
+  "sql",
+
+  /* Module configuration handler table */
+  NULL,
+
+  /* Module command handler table */
+  NULL,
+
+  /* Module authentication handler table */
+  NULL,
+
+  /* Module initialization function */
+  NULL,
+
+  /* Session initialization function */
+  NULL,
+
+  /* Module version */
+  "mod_sql/fake"
+};
+
+static cmdtable sql_hooks[] = {
+  { HOOK, "sql_load_backend",	NULL, sql_load_backend },
+  { HOOK, "sql_prepare",	NULL, sql_prepare },
+  { HOOK, "sql_define_conn",	NULL, sql_define_conn },
+  { HOOK, "sql_open_conn",	NULL, sql_open_conn },
+  { HOOK, "sql_select",		NULL, sql_select },
+  { HOOK, "sql_close_conn",	NULL, sql_close_conn },
+  { HOOK, "sql_cleanup",	NULL, sql_cleanup },
+  { 0, NULL }
+};
+
+int tests_sql_register(pool *p) {
+  register unsigned int i;
+
+  if (p == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  sql_pool = make_sub_pool(p);
+  sql_ctxs = make_array(sql_pool, 0, sizeof(struct sql_ctx));
+  sql_confs = make_array(sql_pool, 0, sizeof(struct sql_conf));
+  sql_maps = make_array(sql_pool, 0, sizeof(struct sql_map));
+  sql_docs = make_array(sql_pool, 0, sizeof(struct sql_doc));
+  sql_nrows = 0;
+  memset(sql_hook_info, 0, sizeof(sql_hook_info));
+
+  for (i = 0; sql_hooks[i].command != NULL; i++) {
+    sql_hooks[i].m = &sql_module;
+
+    if (pr_stash_add_symbol(PR_SYM_HOOK, &(sql_hooks[i])) < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+void tests_sql_unregister(void) {
+  register unsigned int i;
+
+  for (i = 0; sql_hooks[i].command != NULL; i++) {
+    (void) pr_stash_remove_symbol(PR_SYM_HOOK, sql_hooks[i].command,
+      &sql_module);
+  }
+
+  if (sql_pool != NULL) {
+    destroy_pool(sql_pool);
+    sql_pool = NULL;
+    sql_ctxs = sql_confs = sql_maps = sql_docs = NULL;
+  }
+}
+
+int tests_sql_add_ctx(int id, int parent_id, const char *type,
+    const char *value) {
+  struct sql_ctx *ctx;
+
+  if (sql_pool == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  ctx = push_array(sql_ctxs);
+  ctx->id = id;
+  ctx->parent_id = parent_id;
+  ctx->type = type != NULL ? pstrdup(sql_pool, type) : NULL;
+  ctx->value = value != NULL ? pstrdup(sql_pool, value) : NULL;
+
+  return 0;
+}
+
+int tests_sql_add_conf(int id, int ctx_id, const char *name,
+    const char *value) {
+  struct sql_conf *conf;
+
+  if (sql_pool == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  conf = push_array(sql_confs);
+  conf->id = id;
+  conf->name = pstrdup(sql_pool, name);
+  conf->value = value != NULL ? pstrdup(sql_pool, value) : "";
+
+  if (ctx_id > 0) {
+    return tests_sql_add_map(id, ctx_id);
+  }
+
+  return 0;
+}
+
+int tests_sql_add_map(int conf_id, int ctx_id) {
+  struct sql_map *map;
+
+  if (sql_pool == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  map = push_array(sql_maps);
+  map->conf_id = conf_id;
+  map->ctx_id = ctx_id;
+
+  return 0;
+}
+
+int tests_sql_add_doc(int id, const char *doc) {
+  struct sql_doc *d;
+
+  if (sql_pool == NULL) {
+    errno = EPERM;
+    return -1;
+  }
+
+  d = push_array(sql_docs);
+  d->id = id;
+  d->doc = pstrdup(sql_pool, doc);
+
+  return 0;
+}
+
+static int sql_get_hook(const char *name) {
+  register unsigned int i;
+
+  if (name == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  for (i = 0; sql_hooks[i].command != NULL; i++) {
+    if (strcmp(sql_hooks[i].command, name) == 0) {
+      return i;
+    }
+  }
+
+  errno = ENOENT;
+  return -1;
+}
+
+int tests_sql_fail_hook(const char *name, int fail) {
+  int hook;
+
+  hook = sql_get_hook(name);
+  if (hook < 0) {
+    return -1;
+  }
+
+  sql_hook_info[hook].fail = fail;
+  return 0;
+}
+
+unsigned long tests_sql_get_calls(const char *name) {
+  int hook;
+
+  hook = sql_get_hook(name);
+  if (hook < 0) {
+    return 0;
+  }
+
+  return sql_hook_info[hook].ncalls;
+}
+
+unsigned long tests_sql_get_rows(void) {
+  return sql_nrows;
+}
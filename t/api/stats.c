@@ -0,0 +1,564 @@
+/*
+ * ProFTPD - mod_conf_sql testsuite
+ * Copyright (c) 2016 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+/* Stats API tests. */
+
+#include "tests.h"
+
+static pool *p = NULL;
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = make_sub_pool(NULL);
+  }
+
+  sqlconf_stats_reset();
+}
+
+static void tear_down(void) {
+  if (p) {
+    destroy_pool(p);
+    p = NULL;
+  }
+}
+
+START_TEST (stats_mem_alloc_test) {
+  int res;
+  uint64_t allocated = 0, in_use = 0;
+
+  mark_point();
+  res = sqlconf_stats_mem_alloc(CONF_SQL_MEM_MAX+1, 1);
+  fail_unless(res < 0, "Failed to handle invalid phase");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_stats_mem_alloc(CONF_SQL_MEM_RESULTS, 64);
+  fail_unless(res == 0, "Failed to record allocation: %s", strerror(errno));
+
+  res = sqlconf_stats_mem_alloc(CONF_SQL_MEM_LINES, 32);
+  fail_unless(res == 0, "Failed to record allocation: %s", strerror(errno));
+
+  res = sqlconf_stats_mem_get(CONF_SQL_MEM_RESULTS, &allocated, &in_use);
+  fail_unless(res == 0, "Failed to get stats: %s", strerror(errno));
+  fail_unless(allocated == 64, "Expected 64 bytes allocated, got %lu",
+    (unsigned long) allocated);
+  fail_unless(in_use == 64, "Expected 64 bytes in use, got %lu",
+    (unsigned long) in_use);
+
+  fail_unless(sqlconf_stats_mem_peak() == 96, "Expected peak of 96, got %lu",
+    (unsigned long) sqlconf_stats_mem_peak());
+
+  mark_point();
+  res = sqlconf_stats_mem_get(CONF_SQL_MEM_MAX+1, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle invalid phase");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+}
+END_TEST
+
+START_TEST (stats_mem_release_test) {
+  int res;
+  uint64_t allocated = 0, in_use = 0;
+
+  mark_point();
+  res = sqlconf_stats_mem_release(CONF_SQL_MEM_RESULTS, 1);
+  fail_unless(res < 0, "Failed to handle release without allocation");
+  fail_unless(errno == EPERM, "Expected EPERM (%d), got %s (%d)", EPERM,
+    strerror(errno), errno);
+
+  res = sqlconf_stats_mem_alloc(CONF_SQL_MEM_RESULTS, 64);
+  fail_unless(res == 0, "Failed to record allocation: %s", strerror(errno));
+
+  mark_point();
+  res = sqlconf_stats_mem_release(CONF_SQL_MEM_RESULTS, 64);
+  fail_unless(res == 0, "Failed to record release: %s", strerror(errno));
+
+  res = sqlconf_stats_mem_alloc(CONF_SQL_MEM_RESULTS, 16);
+  fail_unless(res == 0, "Failed to record allocation: %s", strerror(errno));
+
+  res = sqlconf_stats_mem_get(CONF_SQL_MEM_RESULTS, &allocated, &in_use);
+  fail_unless(res == 0, "Failed to get stats: %s", strerror(errno));
+  fail_unless(allocated == 80, "Expected 80 bytes allocated, got %lu",
+    (unsigned long) allocated);
+  fail_unless(in_use == 16, "Expected 16 bytes in use, got %lu",
+    (unsigned long) in_use);
+
+  /* The peak is the high-water mark, not the total allocated. */
+  fail_unless(sqlconf_stats_mem_peak() == 64, "Expected peak of 64, got %lu",
+    (unsigned long) sqlconf_stats_mem_peak());
+}
+END_TEST
+
+START_TEST (stats_mem_phase_test) {
+  const char *phase;
+
+  mark_point();
+  phase = sqlconf_stats_mem_phase(CONF_SQL_MEM_MAX+1);
+  fail_unless(phase == NULL, "Failed to handle invalid phase");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  phase = sqlconf_stats_mem_phase(CONF_SQL_MEM_SNAPSHOT);
+  fail_unless(phase != NULL, "Failed to get phase name: %s", strerror(errno));
+  fail_unless(strcmp(phase, "snapshot") == 0,
+    "Expected 'snapshot', got '%s'", phase);
+}
+END_TEST
+
+START_TEST (stats_usage_test) {
+  int res;
+  struct sqlconf_usage delta;
+
+  mark_point();
+  res = sqlconf_stats_usage_get(NULL);
+  fail_unless(res < 0, "Failed to handle null delta");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_stats_usage_get(&delta);
+  fail_unless(res < 0, "Failed to handle missing samples");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  res = sqlconf_stats_usage_begin();
+  fail_unless(res == 0, "Failed to sample usage: %s", strerror(errno));
+
+  res = sqlconf_stats_usage_end();
+  fail_unless(res == 0, "Failed to sample usage: %s", strerror(errno));
+
+  mark_point();
+  res = sqlconf_stats_usage_get(&delta);
+  fail_unless(res == 0, "Failed to get usage: %s", strerror(errno));
+  fail_unless(delta.utime_usecs >= 0, "Expected non-negative user time");
+  fail_unless(delta.stime_usecs >= 0, "Expected non-negative system time");
+
+  mark_point();
+  sqlconf_stats_reset();
+  res = sqlconf_stats_usage_get(&delta);
+  fail_unless(res < 0, "Failed to handle reset samples");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+}
+END_TEST
+
+START_TEST (stats_now_test) {
+  uint64_t t1, t2;
+
+  t1 = sqlconf_stats_now();
+  fail_unless(t1 > 0, "Expected non-zero time");
+
+  t2 = sqlconf_stats_now();
+  fail_unless(t2 >= t1, "Expected monotonic time");
+}
+END_TEST
+
+START_TEST (stats_time_test) {
+  int res;
+  uint64_t nsecs = 0;
+
+  mark_point();
+  res = sqlconf_stats_time_add(CONF_SQL_TIME_MAX+1, 1);
+  fail_unless(res < 0, "Failed to handle invalid phase");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_stats_time_get(CONF_SQL_TIME_OPEN, NULL);
+  fail_unless(res < 0, "Failed to handle null nsecs");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = sqlconf_stats_time_add(CONF_SQL_TIME_OPEN, 1000);
+  fail_unless(res == 0, "Failed to add time: %s", strerror(errno));
+
+  res = sqlconf_stats_time_add(CONF_SQL_TIME_OPEN, 500);
+  fail_unless(res == 0, "Failed to add time: %s", strerror(errno));
+
+  res = sqlconf_stats_time_get(CONF_SQL_TIME_OPEN, &nsecs);
+  fail_unless(res == 0, "Failed to get time: %s", strerror(errno));
+  fail_unless(nsecs == 1500, "Expected 1500 nsecs, got %lu",
+    (unsigned long) nsecs);
+}
+END_TEST
+
+START_TEST (stats_count_test) {
+  int res;
+  uint64_t n = 0;
+
+  mark_point();
+  res = sqlconf_stats_count_add(CONF_SQL_COUNT_MAX+1, 1);
+  fail_unless(res < 0, "Failed to handle invalid counter");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = sqlconf_stats_count_add(CONF_SQL_COUNT_ROWS, 3);
+  fail_unless(res == 0, "Failed to add count: %s", strerror(errno));
+
+  res = sqlconf_stats_count_get(CONF_SQL_COUNT_ROWS, &n);
+  fail_unless(res == 0, "Failed to get count: %s", strerror(errno));
+  fail_unless(n == 3, "Expected 3 rows, got %lu", (unsigned long) n);
+
+  sqlconf_stats_reset();
+
+  res = sqlconf_stats_count_get(CONF_SQL_COUNT_ROWS, &n);
+  fail_unless(res == 0, "Failed to get count: %s", strerror(errno));
+  fail_unless(n == 0, "Expected 0 rows after reset, got %lu",
+    (unsigned long) n);
+}
+END_TEST
+
+START_TEST (stats_save_test) {
+  int fallback = FALSE, res;
+  uint64_t n = 0;
+  struct sqlconf_stats_state *state;
+  const char *backend;
+
+  mark_point();
+  state = sqlconf_stats_save(NULL);
+  fail_unless(state == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_stats_restore(NULL);
+  fail_unless(res < 0, "Failed to handle null state");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  (void) sqlconf_stats_count_add(CONF_SQL_COUNT_QUERIES, 7);
+  (void) sqlconf_stats_time_add(CONF_SQL_TIME_TOTAL, 1000);
+  (void) sqlconf_stats_mem_alloc(CONF_SQL_MEM_LINES, 64);
+  sqlconf_stats_set_backend("mod_sql");
+
+  mark_point();
+  state = sqlconf_stats_save(p);
+  fail_unless(state != NULL, "Failed to save stats: %s", strerror(errno));
+
+  sqlconf_stats_reset();
+  (void) sqlconf_stats_count_add(CONF_SQL_COUNT_QUERIES, 2);
+  sqlconf_stats_set_backend("sqlite");
+
+  mark_point();
+  res = sqlconf_stats_restore(state);
+  fail_unless(res == 0, "Failed to restore stats: %s", strerror(errno));
+
+  res = sqlconf_stats_count_get(CONF_SQL_COUNT_QUERIES, &n);
+  fail_unless(res == 0, "Failed to get count: %s", strerror(errno));
+  fail_unless(n == 7, "Expected 7 queries, got %lu", (unsigned long) n);
+
+  res = sqlconf_stats_time_get(CONF_SQL_TIME_TOTAL, &n);
+  fail_unless(res == 0, "Failed to get time: %s", strerror(errno));
+  fail_unless(n == 1000, "Expected 1000 nsecs, got %lu", (unsigned long) n);
+
+  fail_unless(sqlconf_stats_mem_peak() == 64, "Expected peak 64, got %lu",
+    (unsigned long) sqlconf_stats_mem_peak());
+
+  backend = sqlconf_stats_get_backend(&fallback);
+  fail_unless(backend != NULL && strcmp(backend, "mod_sql") == 0,
+    "Expected backend 'mod_sql', got '%s'", backend);
+}
+END_TEST
+
+START_TEST (stats_query_test) {
+  int res;
+  uint64_t n = 0, nsecs = 0;
+  struct sqlconf_hist hist;
+
+  mark_point();
+  res = sqlconf_stats_query_add(CONF_SQL_QUERY_MAX+1, 1);
+  fail_unless(res < 0, "Failed to handle invalid shape");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_stats_query_get(CONF_SQL_QUERY_CTX, NULL);
+  fail_unless(res < 0, "Failed to handle null histogram");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* Under 1us, 1.5us, and 10 seconds. */
+  res = sqlconf_stats_query_add(CONF_SQL_QUERY_CTX, 500);
+  fail_unless(res == 0, "Failed to add query: %s", strerror(errno));
+  res = sqlconf_stats_query_add(CONF_SQL_QUERY_CTX, 1500);
+  fail_unless(res == 0, "Failed to add query: %s", strerror(errno));
+  res = sqlconf_stats_query_add(CONF_SQL_QUERY_CTX, 10000000000ULL);
+  fail_unless(res == 0, "Failed to add query: %s", strerror(errno));
+
+  res = sqlconf_stats_query_get(CONF_SQL_QUERY_CTX, &hist);
+  fail_unless(res == 0, "Failed to get histogram: %s", strerror(errno));
+  fail_unless(hist.count == 3, "Expected 3 queries, got %lu",
+    (unsigned long) hist.count);
+  fail_unless(hist.max_nsecs == 10000000000ULL, "Unexpected max %lu",
+    (unsigned long) hist.max_nsecs);
+  fail_unless(hist.buckets[0] == 1, "Expected 1 query under 1us, got %lu",
+    (unsigned long) hist.buckets[0]);
+  fail_unless(hist.buckets[1] == 1, "Expected 1 query under 2us, got %lu",
+    (unsigned long) hist.buckets[1]);
+  fail_unless(hist.buckets[CONF_SQL_HIST_NBUCKETS-1] == 1,
+    "Expected 1 query in last bucket, got %lu",
+    (unsigned long) hist.buckets[CONF_SQL_HIST_NBUCKETS-1]);
+
+  /* Queries are also counted, and timed, overall. */
+  res = sqlconf_stats_count_get(CONF_SQL_COUNT_QUERIES, &n);
+  fail_unless(res == 0, "Failed to get count: %s", strerror(errno));
+  fail_unless(n == 3, "Expected 3 queries, got %lu", (unsigned long) n);
+
+  res = sqlconf_stats_time_get(CONF_SQL_TIME_QUERY, &nsecs);
+  fail_unless(res == 0, "Failed to get time: %s", strerror(errno));
+  fail_unless(nsecs == hist.total_nsecs, "Expected %lu nsecs, got %lu",
+    (unsigned long) hist.total_nsecs, (unsigned long) nsecs);
+
+  mark_point();
+  sqlconf_stats_log_summary();
+}
+END_TEST
+
+START_TEST (stats_dispatch_test) {
+  register unsigned int i;
+  int res;
+
+  mark_point();
+  res = sqlconf_stats_dispatch_add(NULL, 1);
+  fail_unless(res < 0, "Failed to handle null name");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = sqlconf_stats_dispatch_add("sql_select", 1);
+  fail_unless(res == 0, "Failed to add dispatch: %s", strerror(errno));
+
+  res = sqlconf_stats_dispatch_add("sql_select", 1);
+  fail_unless(res == 0, "Failed to add dispatch: %s", strerror(errno));
+
+  /* Only a limited number of distinct hooks are tracked. */
+  for (i = 0; i < 16; i++) {
+    char name[32];
+
+    memset(name, '\0', sizeof(name));
+    snprintf(name, sizeof(name)-1, "hook%u", i);
+
+    res = sqlconf_stats_dispatch_add(pstrdup(p, name), 1);
+    if (res < 0) {
+      break;
+    }
+  }
+
+  fail_unless(res < 0, "Failed to handle too many hooks");
+  fail_unless(errno == ENOSPC, "Expected ENOSPC (%d), got %s (%d)", ENOSPC,
+    strerror(errno), errno);
+
+  mark_point();
+  sqlconf_stats_log_summary();
+}
+END_TEST
+
+static char *read_file(const char *path) {
+  FILE *fh;
+  char *text;
+  size_t len;
+
+  fh = fopen(path, "r");
+  if (fh == NULL) {
+    return NULL;
+  }
+
+  text = pcalloc(p, 16384);
+  len = fread(text, 1, 16383, fh);
+  text[len] = '\0';
+  fclose(fh);
+
+  return text;
+}
+
+START_TEST (stats_write_test) {
+  int res, fallback;
+  const char *backend, *path = "/tmp/mod_conf_sql-stats.json";
+  char *text;
+
+  mark_point();
+  res = sqlconf_stats_write(NULL, NULL, 0, TRUE);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_stats_write(p, path, 0, TRUE);
+  fail_unless(res < 0, "Failed to handle invalid format");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_stats_write(p, "/no/such/dir/stats.json",
+    CONF_SQL_STATS_FMT_JSON, TRUE);
+  fail_unless(res < 0, "Failed to handle missing directory");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  sqlconf_stats_set_backend("sqlite");
+  fallback = TRUE;
+  backend = sqlconf_stats_get_backend(&fallback);
+  fail_unless(backend != NULL && strcmp(backend, "sqlite") == 0,
+    "Expected 'sqlite', got '%s'", backend);
+  fail_unless(fallback == FALSE, "Expected no fallback");
+
+  (void) sqlconf_stats_count_add(CONF_SQL_COUNT_CTXS, 2);
+  (void) sqlconf_stats_query_add(CONF_SQL_QUERY_CONFS, 1500);
+
+  mark_point();
+  res = sqlconf_stats_write(p, path, CONF_SQL_STATS_FMT_JSON, TRUE);
+  fail_unless(res == 0, "Failed to write stats: %s", strerror(errno));
+
+  text = read_file(path);
+  fail_unless(text != NULL, "Failed to read '%s': %s", path, strerror(errno));
+  fail_unless(strstr(text, "\"success\": true") != NULL,
+    "Missing success in '%s'", text);
+  fail_unless(strstr(text, "\"backend\": \"sqlite\"") != NULL,
+    "Missing backend in '%s'", text);
+  fail_unless(strstr(text, "\"contexts\": 2,") != NULL,
+    "Missing contexts in '%s'", text);
+  (void) unlink(path);
+
+  path = "/tmp/mod_conf_sql-stats.prom";
+
+  mark_point();
+  res = sqlconf_stats_write(p, path, CONF_SQL_STATS_FMT_PROMETHEUS, FALSE);
+  fail_unless(res == 0, "Failed to write stats: %s", strerror(errno));
+
+  text = read_file(path);
+  fail_unless(text != NULL, "Failed to read '%s': %s", path, strerror(errno));
+  fail_unless(strstr(text, "\nproftpd_conf_sql_load_success 0\n") != NULL,
+    "Missing success in '%s'", text);
+  fail_unless(strstr(text, "proftpd_conf_sql_load_contexts 2\n") != NULL,
+    "Missing contexts in '%s'", text);
+  fail_unless(strstr(text, "proftpd_conf_sql_query_duration_seconds_bucket"
+    "{shape=\"confs\",le=\"0.000002000\"} 1\n") != NULL,
+    "Missing histogram bucket in '%s'", text);
+  fail_unless(strstr(text, "proftpd_conf_sql_query_duration_seconds_count"
+    "{shape=\"confs\"} 1\n") != NULL, "Missing histogram count in '%s'",
+    text);
+  (void) unlink(path);
+}
+END_TEST
+
+START_TEST (stats_open_tmp_test) {
+  int res;
+  const char *path = "/tmp/mod_conf_sql-tmp.txt";
+  char *tmp_path = NULL, *other_path = NULL, *text;
+  FILE *fh, *other_fh;
+  struct stat st;
+
+  mark_point();
+  fh = sqlconf_stats_open_tmp(NULL, NULL, 0644, NULL);
+  fail_unless(fh == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  fh = sqlconf_stats_open_tmp(p, "/no/such/dir/file", 0644, &tmp_path);
+  fail_unless(fh == NULL, "Failed to handle missing directory");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  /* Each temporary file is a new, uniquely named file, with the given mode
+   * regardless of the umask.
+   */
+  mark_point();
+  fh = sqlconf_stats_open_tmp(p, path, 0600, &tmp_path);
+  fail_unless(fh != NULL, "Failed to open temporary file: %s",
+    strerror(errno));
+
+  other_fh = sqlconf_stats_open_tmp(p, path, 0644, &other_path);
+  fail_unless(other_fh != NULL, "Failed to open temporary file: %s",
+    strerror(errno));
+  fail_unless(strcmp(tmp_path, other_path) != 0,
+    "Expected distinct temporary files, got '%s' twice", tmp_path);
+
+  fail_unless(lstat(tmp_path, &st) == 0, "Failed to stat '%s': %s", tmp_path,
+    strerror(errno));
+  fail_unless(S_ISREG(st.st_mode), "Expected regular file '%s'", tmp_path);
+  fail_unless((st.st_mode & 0777) == 0600, "Expected mode 0600, got %04o",
+    (unsigned int) (st.st_mode & 0777));
+
+  fail_unless(lstat(other_path, &st) == 0, "Failed to stat '%s': %s",
+    other_path, strerror(errno));
+  fail_unless((st.st_mode & 0777) == 0644, "Expected mode 0644, got %04o",
+    (unsigned int) (st.st_mode & 0777));
+
+  fprintf(fh, "kept\n");
+
+  mark_point();
+  res = sqlconf_stats_close_tmp(fh, tmp_path, path, TRUE);
+  fail_unless(res == 0, "Failed to close temporary file: %s",
+    strerror(errno));
+  fail_unless(lstat(tmp_path, &st) < 0, "Temporary file '%s' still exists",
+    tmp_path);
+
+  text = read_file(path);
+  fail_unless(text != NULL && strcmp(text, "kept\n") == 0,
+    "Expected 'kept', got '%s'", text);
+
+  /* A temporary file not kept is removed, leaving the path as it was. */
+  fprintf(other_fh, "discarded\n");
+
+  mark_point();
+  res = sqlconf_stats_close_tmp(other_fh, other_path, path, FALSE);
+  fail_unless(res == 0, "Failed to close temporary file: %s",
+    strerror(errno));
+  fail_unless(lstat(other_path, &st) < 0, "Temporary file '%s' still exists",
+    other_path);
+
+  text = read_file(path);
+  fail_unless(text != NULL && strcmp(text, "kept\n") == 0,
+    "Expected 'kept', got '%s'", text);
+  (void) unlink(path);
+}
+END_TEST
+
+Suite *tests_get_stats_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("stats");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, stats_mem_alloc_test);
+  tcase_add_test(testcase, stats_mem_release_test);
+  tcase_add_test(testcase, stats_mem_phase_test);
+  tcase_add_test(testcase, stats_usage_test);
+  tcase_add_test(testcase, stats_now_test);
+  tcase_add_test(testcase, stats_time_test);
+  tcase_add_test(testcase, stats_count_test);
+  tcase_add_test(testcase, stats_save_test);
+  tcase_add_test(testcase, stats_query_test);
+  tcase_add_test(testcase, stats_dispatch_test);
+  tcase_add_test(testcase, stats_write_test);
+  tcase_add_test(testcase, stats_open_tmp_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
@@ -88,3 +88,279 @@ int pr_trace_msg(const char *trace_channel, int level, const char *fmt, ...) {
 
   return 0;
 }
+
+/* Core API stubs, for running the module itself. */
+
+#define TESTS_STUB_MAX_HOOKS		32
+#define TESTS_STUB_MAX_EVENTS		8
+
+static cmdtable *stub_hooks[TESTS_STUB_MAX_HOOKS];
+static unsigned int stub_nhooks = 0;
+
+static pr_fs_t *stub_fs = NULL;
+
+static struct {
+  const char *event;
+  void (*cb)(const void *, void *);
+  void *user_data;
+} stub_events[TESTS_STUB_MAX_EVENTS];
+static unsigned int stub_nevents = 0;
+
+int pr_stash_add_symbol(pr_stash_type_t sym_type, void *data) {
+  if (sym_type != PR_SYM_HOOK ||
+      data == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (stub_nhooks == TESTS_STUB_MAX_HOOKS) {
+    errno = ENOSPC;
+    return -1;
+  }
+
+  stub_hooks[stub_nhooks++] = data;
+  return 0;
+}
+
+void *pr_stash_get_symbol(pr_stash_type_t sym_type, const char *name,
+    void *prev, int *idx_cache) {
+  register unsigned int i;
+
+  if (sym_type != PR_SYM_HOOK ||
+      name == NULL ||
+      prev != NULL) {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  for (i = 0; i < stub_nhooks; i++) {
+    if (strcmp(stub_hooks[i]->command, name) == 0) {
+      return stub_hooks[i];
+    }
+  }
+
+  errno = ENOENT;
+  return NULL;
+}
+
+void *pr_stash_get_symbol2(pr_stash_type_t sym_type, const char *name,
+    void *prev, int *idx_cache, unsigned int *hash_cache) {
+  return pr_stash_get_symbol(sym_type, name, prev, idx_cache);
+}
+
+int pr_stash_remove_symbol(pr_stash_type_t sym_type, const char *name,
+    module *m) {
+  register unsigned int i;
+  int count = 0;
+
+  for (i = 0; i < stub_nhooks;) {
+    if (strcmp(stub_hooks[i]->command, name) == 0 &&
+        (m == NULL || stub_hooks[i]->m == m)) {
+      stub_hooks[i] = stub_hooks[--stub_nhooks];
+      count++;
+      continue;
+    }
+
+    i++;
+  }
+
+  return count;
+}
+
+int pr_module_exists(const char *name) {
+  register unsigned int i;
+  char buf[256];
+
+  for (i = 0; i < stub_nhooks; i++) {
+    snprintf(buf, sizeof(buf)-1, "mod_%s.c", stub_hooks[i]->m->name);
+    buf[sizeof(buf)-1] = '\0';
+
+    if (strcmp(buf, name) == 0) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+modret_t *pr_module_call(module *m, modret_t *(*func)(cmd_rec *),
+    cmd_rec *cmd) {
+  if (m == NULL ||
+      func == NULL ||
+      cmd == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  return func(cmd);
+}
+
+modret_t *mod_create_ret(cmd_rec *cmd, unsigned char err, const char *n,
+    const char *m) {
+  modret_t *mr;
+
+  mr = pcalloc(cmd->tmp_pool, sizeof(modret_t));
+  mr->mr_error = err;
+  mr->mr_numeric = n != NULL ? pstrdup(cmd->tmp_pool, n) : NULL;
+  mr->mr_message = m != NULL ? pstrdup(cmd->tmp_pool, m) : NULL;
+
+  return mr;
+}
+
+modret_t *mod_create_error(cmd_rec *cmd, int mr_errno) {
+  modret_t *mr;
+
+  mr = pcalloc(cmd->tmp_pool, sizeof(modret_t));
+  mr->mr_error = mr_errno;
+
+  return mr;
+}
+
+modret_t *mod_create_data(cmd_rec *cmd, void *d) {
+  modret_t *mr;
+
+  mr = pcalloc(cmd->tmp_pool, sizeof(modret_t));
+  mr->data = d;
+
+  return mr;
+}
+
+pr_fs_t *pr_register_fs(pool *p, const char *name, const char *path) {
+  if (stub_fs != NULL) {
+    errno = EEXIST;
+    return NULL;
+  }
+
+  stub_fs = pcalloc(p, sizeof(pr_fs_t));
+  stub_fs->fs_name = pstrdup(p, name);
+  stub_fs->fs_path = pstrdup(p, path);
+
+  return stub_fs;
+}
+
+int pr_unregister_fs(const char *path) {
+  if (stub_fs == NULL ||
+      strcmp(stub_fs->fs_path, path) != 0) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  stub_fs = NULL;
+  return 0;
+}
+
+pr_fs_t *pr_get_fs(const char *path, int *exact) {
+  if (stub_fs == NULL ||
+      strncmp(stub_fs->fs_path, path, strlen(stub_fs->fs_path)) != 0) {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  return stub_fs;
+}
+
+int pr_event_register(module *m, const char *event,
+    void (*cb)(const void *, void *), void *user_data) {
+  if (stub_nevents == TESTS_STUB_MAX_EVENTS) {
+    errno = ENOSPC;
+    return -1;
+  }
+
+  stub_events[stub_nevents].event = event;
+  stub_events[stub_nevents].cb = cb;
+  stub_events[stub_nevents].user_data = user_data;
+  stub_nevents++;
+
+  return 0;
+}
+
+void pr_event_generate(const char *event, const void *event_data) {
+  register unsigned int i;
+
+  for (i = 0; i < stub_nevents; i++) {
+    if (strcmp(stub_events[i].event, event) == 0) {
+      stub_events[i].cb(event_data, stub_events[i].user_data);
+    }
+  }
+}
+
+int pr_trace_set_levels(const char *channel, int min_level, int max_level) {
+  return 0;
+}
+
+int pr_trace_use_stderr(int use_stderr) {
+  return 0;
+}
+
+cmd_rec *pr_parser_parse_line(pool *p, const char *text,
+    unsigned int text_len) {
+  errno = ENOSYS;
+  return NULL;
+}
+
+config_rec *pr_parser_config_ctxt_get(void) {
+  return NULL;
+}
+
+server_rec *pr_parser_server_ctxt_get(void) {
+  return main_server;
+}
+
+int pr_timer_usleep(unsigned long usecs) {
+  return usleep(usecs);
+}
+
+#ifdef PR_USE_CTRLS
+static int (*stub_ctrls_cb)(pr_ctrls_t *, int, char **) = NULL;
+
+int pr_ctrls_register(const module *m, const char *action, const char *desc,
+    int (*cb)(pr_ctrls_t *, int, char **)) {
+  stub_ctrls_cb = cb;
+  return 0;
+}
+
+int pr_ctrls_add_response(pr_ctrls_t *ctrl, char *fmt, ...) {
+  char buf[PR_TUNABLE_BUFFER_SIZE];
+  va_list msg;
+
+  memset(buf, '\0', sizeof(buf));
+  va_start(msg, fmt);
+  vsnprintf(buf, sizeof(buf)-1, fmt, msg);
+  va_end(msg);
+
+  *((char **) push_array(ctrl->ctrls_cb_resps)) =
+    pstrdup(ctrl->ctrls_tmp_pool, buf);
+  return 0;
+}
+
+unsigned char pr_ctrls_check_acl(const pr_ctrls_t *ctrl,
+    const ctrls_acttab_t *acttab, const char *action) {
+  return TRUE;
+}
+
+void pr_ctrls_init_acl(ctrls_acl_t *acl) {
+}
+
+char *pr_ctrls_set_module_acls(ctrls_acttab_t *acttab, pool *acl_pool,
+    char **actions, const char *allow, const char *type, char *list) {
+  return NULL;
+}
+
+int tests_ctrls_run(pool *p, int argc, char **argv, array_header **resps) {
+  pr_ctrls_t ctrl;
+  int res;
+
+  if (stub_ctrls_cb == NULL) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  memset(&ctrl, 0, sizeof(ctrl));
+  ctrl.ctrls_tmp_pool = p;
+  ctrl.ctrls_cb_resps = make_array(p, 1, sizeof(char *));
+
+  res = (stub_ctrls_cb)(&ctrl, argc, argv);
+  *resps = ctrl.ctrls_cb_resps;
+  return res;
+}
+#endif /* PR_USE_CTRLS */
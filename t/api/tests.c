@@ -32,6 +32,13 @@ struct testsuite_info {
 static struct testsuite_info suites[] = {
   { "uri",		tests_get_uri_suite },
   { "param",		tests_get_param_suite },
+  { "json",		tests_get_json_suite },
+  { "tree",		tests_get_tree_suite },
+  { "stats",		tests_get_stats_suite },
+  { "lookup",		tests_get_lookup_suite },
+  { "profile",		tests_get_profile_suite },
+  { "record",		tests_get_record_suite },
+  { "read",		tests_get_read_suite },
 
   { NULL, NULL }
 };
@@ -31,6 +31,16 @@
 
 #include "uri.h"
 #include "param.h"
+#include "json.h"
+#include "tree.h"
+#include "stats.h"
+#include "lookup.h"
+#include "profile.h"
+#include "record.h"
+
+#ifdef PR_USE_CTRLS
+# include "mod_ctrls.h"
+#endif /* PR_USE_CTRLS */
 
 #ifdef HAVE_CHECK_H
 # include <check.h>
@@ -40,6 +50,34 @@
 
 Suite *tests_get_uri_suite(void);
 Suite *tests_get_param_suite(void);
+Suite *tests_get_json_suite(void);
+Suite *tests_get_tree_suite(void);
+Suite *tests_get_stats_suite(void);
+Suite *tests_get_lookup_suite(void);
+Suite *tests_get_profile_suite(void);
+Suite *tests_get_record_suite(void);
+Suite *tests_get_read_suite(void);
+
+/* Fake mod_sql, for the read tests.  Context and directive IDs start at 1;
+ * a parent ID of 0 is NULL, as is a directive context ID of 0, for a
+ * directive not (yet) mapped to a context.
+ */
+int tests_sql_register(pool *p);
+void tests_sql_unregister(void);
+int tests_sql_add_ctx(int id, int parent_id, const char *type,
+  const char *value);
+int tests_sql_add_conf(int id, int ctx_id, const char *name,
+  const char *value);
+int tests_sql_add_map(int conf_id, int ctx_id);
+int tests_sql_add_doc(int id, const char *doc);
+int tests_sql_fail_hook(const char *name, int fail);
+unsigned long tests_sql_get_calls(const char *name);
+unsigned long tests_sql_get_rows(void);
+
+#ifdef PR_USE_CTRLS
+/* Runs the registered controls action, returning its responses. */
+int tests_ctrls_run(pool *p, int argc, char **argv, array_header **resps);
+#endif /* PR_USE_CTRLS */
 
 unsigned int recvd_signal_flags;
 extern pid_t mpid;
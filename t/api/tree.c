@@ -0,0 +1,398 @@
+/*
+ * ProFTPD - mod_conf_sql testsuite
+ * Copyright (c) 2016 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* Tree API tests. */
+
+#include "tests.h"
+
+static pool *p = NULL;
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = make_sub_pool(NULL);
+  }
+}
+
+static void tear_down(void) {
+  if (p) {
+    destroy_pool(p);
+    p = NULL;
+  }
+}
+
+START_TEST (tree_create_test) {
+  sqlconf_tree_t *tree;
+
+  mark_point();
+  tree = sqlconf_tree_create(NULL, 0);
+  fail_unless(tree == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  tree = sqlconf_tree_create(p, 0);
+  fail_unless(tree != NULL, "Failed to create tree: %s", strerror(errno));
+  fail_unless(sqlconf_tree_get_size(tree) == 0, "Expected empty tree");
+}
+END_TEST
+
+START_TEST (tree_add_ctx_test) {
+  int res;
+  sqlconf_tree_t *tree;
+
+  tree = sqlconf_tree_create(p, 0);
+
+  mark_point();
+  res = sqlconf_tree_add_ctx(NULL, NULL, NULL, NULL, NULL, TRUE);
+  fail_unless(res < 0, "Failed to handle null tree");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_tree_add_ctx(tree, NULL, NULL, NULL, NULL, TRUE);
+  fail_unless(res < 0, "Failed to handle null ID");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_tree_add_ctx(tree, "foo", NULL, "default", NULL, TRUE);
+  fail_unless(res < 0, "Failed to handle invalid ID");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_tree_add_ctx(tree, "1", NULL, "default", NULL, TRUE);
+  fail_unless(res == 0, "Failed to add context: %s", strerror(errno));
+
+  mark_point();
+  res = sqlconf_tree_add_ctx(tree, "1", NULL, "default", NULL, TRUE);
+  fail_unless(res < 0, "Failed to handle duplicate ID");
+  fail_unless(errno == EEXIST, "Expected EEXIST (%d), got %s (%d)", EEXIST,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_tree_add_ctx(tree, "2", "bar", "<Anonymous>", "~ftp", TRUE);
+  fail_unless(res < 0, "Failed to handle invalid parent ID");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+}
+END_TEST
+
+START_TEST (tree_add_conf_test) {
+  int res;
+  sqlconf_tree_t *tree;
+
+  tree = sqlconf_tree_create(p, 0);
+
+  mark_point();
+  res = sqlconf_tree_add_conf(NULL, NULL, NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null tree");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_tree_add_conf(tree, "1", NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null name");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_tree_add_conf(tree, "1.5", "ServerName", "foo", NULL);
+  fail_unless(res < 0, "Failed to handle invalid context ID");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* Directives may be added before their context. */
+  mark_point();
+  res = sqlconf_tree_add_conf(tree, "1", "ServerName", "foo", NULL);
+  fail_unless(res == 0, "Failed to add directive: %s", strerror(errno));
+  fail_unless(sqlconf_tree_get_size(tree) > 0, "Expected non-empty tree");
+}
+END_TEST
+
+START_TEST (tree_select_test) {
+  int res;
+  sqlconf_tree_t *tree;
+  sql_data_t *sd = NULL;
+
+  tree = sqlconf_tree_create(p, CONF_SQL_TREE_FL_ARGV);
+
+  mark_point();
+  res = sqlconf_tree_select(NULL, NULL, 0, 0, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_MAX + 1, 0, NULL, &sd);
+  fail_unless(res < 0, "Failed to handle invalid query shape");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_BASE_CTX, 0, NULL, &sd);
+  fail_unless(res == 0, "Failed to select base context: %s", strerror(errno));
+  fail_unless(sd->rnum == 0, "Expected 0 rows, got %lu", sd->rnum);
+
+  /* Children arrive before their parents, and directives before their
+   * contexts.
+   */
+  (void) sqlconf_tree_add_conf(tree, "2", "MaxClients", "10", NULL);
+  (void) sqlconf_tree_add_ctx(tree, "2", "1", "<Anonymous>", "~ftp", TRUE);
+  (void) sqlconf_tree_add_ctx(tree, "3", "1", "<Directory>", "/tmp", FALSE);
+  (void) sqlconf_tree_add_ctx(tree, "1", NULL, "default", NULL, TRUE);
+  (void) sqlconf_tree_add_conf(tree, "1", "ServerName", "\"foo bar\"",
+    "[\"foo bar\"]");
+  (void) sqlconf_tree_add_conf(tree, "1", "Port", "2121", NULL);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_BASE_CTX, 0, NULL, &sd);
+  fail_unless(res == 0, "Failed to select base context: %s", strerror(errno));
+  fail_unless(sd->rnum == 1, "Expected 1 row, got %lu", sd->rnum);
+  fail_unless(sd->fnum == 1, "Expected 1 field, got %lu", sd->fnum);
+  fail_unless(strcmp(sd->data[0], "1") == 0, "Expected '1', got '%s'",
+    sd->data[0]);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_BASE_CTX, 0, "2", &sd);
+  fail_unless(res == 0, "Failed to select base context: %s", strerror(errno));
+  fail_unless(sd->rnum == 1, "Expected 1 row, got %lu", sd->rnum);
+  fail_unless(strcmp(sd->data[0], "2") == 0, "Expected '2', got '%s'",
+    sd->data[0]);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_BASE_CTX, 0, "7", &sd);
+  fail_unless(res == 0, "Failed to select base context: %s", strerror(errno));
+  fail_unless(sd->rnum == 0, "Expected 0 rows, got %lu", sd->rnum);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CTX, 2, NULL, &sd);
+  fail_unless(res == 0, "Failed to select context: %s", strerror(errno));
+  fail_unless(sd->rnum == 1, "Expected 1 row, got %lu", sd->rnum);
+  fail_unless(sd->fnum == 2, "Expected 2 fields, got %lu", sd->fnum);
+  fail_unless(strcmp(sd->data[0], "<Anonymous>") == 0,
+    "Expected '<Anonymous>', got '%s'", sd->data[0]);
+  fail_unless(strcmp(sd->data[1], "~ftp") == 0, "Expected '~ftp', got '%s'",
+    sd->data[1]);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CTX, 1, NULL, &sd);
+  fail_unless(res == 0, "Failed to select context: %s", strerror(errno));
+  fail_unless(sd->rnum == 1, "Expected 1 row, got %lu", sd->rnum);
+  fail_unless(strcmp(sd->data[1], "") == 0, "Expected '', got '%s'",
+    sd->data[1]);
+
+  /* Contexts not matching the WHERE clause are not returned. */
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CTX, 3, NULL, &sd);
+  fail_unless(res == 0, "Failed to select context: %s", strerror(errno));
+  fail_unless(sd->rnum == 0, "Expected 0 rows, got %lu", sd->rnum);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CHILD_CTXS, 1, NULL, &sd);
+  fail_unless(res == 0, "Failed to select child contexts: %s",
+    strerror(errno));
+  fail_unless(sd->rnum == 1, "Expected 1 row, got %lu", sd->rnum);
+  fail_unless(strcmp(sd->data[0], "2") == 0, "Expected '2', got '%s'",
+    sd->data[0]);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CHILD_CTXS, 2, NULL, &sd);
+  fail_unless(res == 0, "Failed to select child contexts: %s",
+    strerror(errno));
+  fail_unless(sd->rnum == 0, "Expected 0 rows, got %lu", sd->rnum);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CONFS, 1, NULL, &sd);
+  fail_unless(res == 0, "Failed to select directives: %s", strerror(errno));
+  fail_unless(sd->rnum == 2, "Expected 2 rows, got %lu", sd->rnum);
+  fail_unless(sd->fnum == 3, "Expected 3 fields, got %lu", sd->fnum);
+  fail_unless(strcmp(sd->data[0], "ServerName") == 0,
+    "Expected 'ServerName', got '%s'", sd->data[0]);
+  fail_unless(strcmp(sd->data[2], "[\"foo bar\"]") == 0,
+    "Expected '[\"foo bar\"]', got '%s'", sd->data[2]);
+  fail_unless(strcmp(sd->data[3], "Port") == 0, "Expected 'Port', got '%s'",
+    sd->data[3]);
+  fail_unless(strcmp(sd->data[5], "") == 0, "Expected '', got '%s'",
+    sd->data[5]);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CONFS, 2, NULL, &sd);
+  fail_unless(res == 0, "Failed to select directives: %s", strerror(errno));
+  fail_unless(sd->rnum == 1, "Expected 1 row, got %lu", sd->rnum);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CONFS, 4, NULL, &sd);
+  fail_unless(res == 0, "Failed to select directives: %s", strerror(errno));
+  fail_unless(sd->rnum == 0, "Expected 0 rows, got %lu", sd->rnum);
+}
+END_TEST
+
+START_TEST (tree_select_ids_test) {
+  int res;
+  sqlconf_tree_t *tree;
+  sql_data_t *sd = NULL;
+
+  /* IDs sharing their first bytes must still be distinct contexts. */
+  tree = sqlconf_tree_create(p, 0);
+
+  res = sqlconf_tree_add_ctx(tree, "1", NULL, "default", NULL, TRUE);
+  fail_unless(res == 0, "Failed to add context 1: %s", strerror(errno));
+
+  res = sqlconf_tree_add_ctx(tree, "256", "1", "<Global>", NULL, TRUE);
+  fail_unless(res == 0, "Failed to add context 256: %s", strerror(errno));
+
+  res = sqlconf_tree_add_ctx(tree, "512", "256", "<Directory>", "/tmp",
+    TRUE);
+  fail_unless(res == 0, "Failed to add context 512: %s", strerror(errno));
+
+  res = sqlconf_tree_add_ctx(tree, "65537", "1", "<Anonymous>", "~ftp",
+    TRUE);
+  fail_unless(res == 0, "Failed to add context 65537: %s", strerror(errno));
+
+  (void) sqlconf_tree_add_conf(tree, "256", "Umask", "022", NULL);
+  (void) sqlconf_tree_add_conf(tree, "512", "AllowOverwrite", "on", NULL);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CHILD_CTXS, 1, NULL, &sd);
+  fail_unless(res == 0, "Failed to select child contexts: %s",
+    strerror(errno));
+  fail_unless(sd->rnum == 2, "Expected 2 rows, got %lu", sd->rnum);
+  fail_unless(strcmp(sd->data[0], "256") == 0, "Expected '256', got '%s'",
+    sd->data[0]);
+  fail_unless(strcmp(sd->data[1], "65537") == 0, "Expected '65537', got '%s'",
+    sd->data[1]);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CHILD_CTXS, 256, NULL,
+    &sd);
+  fail_unless(res == 0, "Failed to select child contexts: %s",
+    strerror(errno));
+  fail_unless(sd->rnum == 1, "Expected 1 row, got %lu", sd->rnum);
+  fail_unless(strcmp(sd->data[0], "512") == 0, "Expected '512', got '%s'",
+    sd->data[0]);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CTX, 512, NULL, &sd);
+  fail_unless(res == 0, "Failed to select context: %s", strerror(errno));
+  fail_unless(sd->rnum == 1, "Expected 1 row, got %lu", sd->rnum);
+  fail_unless(strcmp(sd->data[0], "<Directory>") == 0,
+    "Expected '<Directory>', got '%s'", sd->data[0]);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CONFS, 512, NULL, &sd);
+  fail_unless(res == 0, "Failed to select directives: %s", strerror(errno));
+  fail_unless(sd->rnum == 1, "Expected 1 row, got %lu", sd->rnum);
+  fail_unless(strcmp(sd->data[0], "AllowOverwrite") == 0,
+    "Expected 'AllowOverwrite', got '%s'", sd->data[0]);
+
+  mark_point();
+  res = sqlconf_tree_select(p, tree, CONF_SQL_QUERY_CONFS, 1, NULL, &sd);
+  fail_unless(res == 0, "Failed to select directives: %s", strerror(errno));
+  fail_unless(sd->rnum == 0, "Expected 0 rows, got %lu", sd->rnum);
+}
+END_TEST
+
+START_TEST (tree_split_copy_row_test) {
+  int res;
+  char *fields[4], *text;
+
+  mark_point();
+  res = sqlconf_tree_split_copy_row(NULL, 0, NULL, 0);
+  fail_unless(res < 0, "Failed to handle null text");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  text = pstrdup(p, "1\t\\N\tdefault\t\n");
+
+  mark_point();
+  res = sqlconf_tree_split_copy_row(text, strlen(text), fields, 4);
+  fail_unless(res == 0, "Failed to split row: %s", strerror(errno));
+  fail_unless(strcmp(fields[0], "1") == 0, "Expected '1', got '%s'",
+    fields[0]);
+  fail_unless(fields[1] == NULL, "Expected null, got '%s'", fields[1]);
+  fail_unless(strcmp(fields[2], "default") == 0,
+    "Expected 'default', got '%s'", fields[2]);
+  fail_unless(strcmp(fields[3], "") == 0, "Expected '', got '%s'",
+    fields[3]);
+
+  text = pstrdup(p, "a\\tb\\\\c\tx\\ny\t\\101\\x42\tz\\\\N");
+
+  mark_point();
+  res = sqlconf_tree_split_copy_row(text, strlen(text), fields, 4);
+  fail_unless(res == 0, "Failed to split row: %s", strerror(errno));
+  fail_unless(strcmp(fields[0], "a\tb\\c") == 0,
+    "Expected 'a\\tb\\\\c', got '%s'", fields[0]);
+  fail_unless(strcmp(fields[1], "x\ny") == 0, "Expected 'x\\ny', got '%s'",
+    fields[1]);
+  fail_unless(strcmp(fields[2], "AB") == 0, "Expected 'AB', got '%s'",
+    fields[2]);
+  fail_unless(strcmp(fields[3], "z\\N") == 0, "Expected 'z\\\\N', got '%s'",
+    fields[3]);
+
+  text = pstrdup(p, "1\t2\n");
+
+  mark_point();
+  res = sqlconf_tree_split_copy_row(text, strlen(text), fields, 4);
+  fail_unless(res < 0, "Failed to handle too few fields");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  text = pstrdup(p, "1\t2\t3\t4\t5\n");
+
+  mark_point();
+  res = sqlconf_tree_split_copy_row(text, strlen(text), fields, 4);
+  fail_unless(res < 0, "Failed to handle too many fields");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  text = pstrdup(p, "1\t2\t3\t4\\");
+
+  mark_point();
+  res = sqlconf_tree_split_copy_row(text, strlen(text), fields, 4);
+  fail_unless(res < 0, "Failed to handle trailing backslash");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+}
+END_TEST
+
+Suite *tests_get_tree_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("tree");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, tree_create_test);
+  tcase_add_test(testcase, tree_add_ctx_test);
+  tcase_add_test(testcase, tree_add_conf_test);
+  tcase_add_test(testcase, tree_select_test);
+  tcase_add_test(testcase, tree_select_ids_test);
+  tcase_add_test(testcase, tree_split_copy_row_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
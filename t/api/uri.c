@@ -373,6 +373,7 @@ END_TEST
 
 START_TEST (uri_parse_params_test) {
   int res;
+  size_t valsz = 0;
   const char *uri;
   char *host = NULL, *path = NULL, *username, *password;
   unsigned int port = 0;
@@ -421,6 +422,28 @@ START_TEST (uri_parse_params_test) {
   res = pr_table_count(params);
   fail_unless(res == 2, "Expected 2 parameters, got %d", res);
 
+  mark_point();
+  pr_table_empty(params);
+  uri = "sql://castaglia.org?foo=bar&baz";
+  res = sqlconf_uri_parse(p, uri, &host, &port, &path, &username, &password,
+    params);
+  fail_unless(res < 0, "Failed to handle invalid URI '%s'", uri);
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+  res = pr_table_count(params);
+  fail_unless(res == 0, "Expected no parameters, got %d", res);
+
+  mark_point();
+  uri = "sql://castaglia.org?foo=a=b&baz=quxx";
+  res = sqlconf_uri_parse(p, uri, &host, &port, &path, &username, &password,
+    params);
+  fail_unless(res == 0, "Failed to parse URI '%s': %s", uri, strerror(errno));
+  fail_unless(strcmp(pr_table_get(params, "foo", NULL), "a=b") == 0,
+    "Expected 'a=b', got '%s'", (char *) pr_table_get(params, "foo", NULL));
+  fail_unless(strcmp(pr_table_get(params, "baz", &valsz), "quxx") == 0,
+    "Expected 'quxx', got '%s'", (char *) pr_table_get(params, "baz", NULL));
+  fail_unless(valsz == 4, "Expected 4, got %lu", (unsigned long) valsz);
+
   pr_table_empty(params);
   pr_table_free(params);
 }
@@ -618,6 +641,55 @@ START_TEST (uri_urldecode_test) {
 }
 END_TEST
 
+START_TEST (uri_urldecode_escapes_test) {
+  register unsigned int i;
+  int res;
+  char *dst;
+  size_t dstsz;
+  struct {
+    const char *src;
+    size_t srcsz;
+    const char *expected;
+  } cases[] = {
+    { "plain", 5, "plain" },
+    { "%41%4a%4B+%7e", 13, "AJK ~" },
+    { "where=id%3D1", 12, "where=id=1" },
+
+    /* Invalid or truncated escapes are kept as is. */
+    { "100%", 4, "100%" },
+    { "%4", 2, "%4" },
+    { "%zz%4g", 6, "%zz%4g" },
+    { "%%41", 4, "%A" },
+
+    /* Decoding stops at the given size, or at any NUL, encoded or not. */
+    { "foo+bar", 3, "foo" },
+    { "%41%42", 5, "A%4" },
+    { "a%00b", 5, "a" },
+    { "%00", 3, "" },
+    { "ab\0cd", 5, "ab" },
+
+    { NULL, 0, NULL }
+  };
+
+  for (i = 0; cases[i].src != NULL; i++) {
+    dst = NULL;
+    dstsz = 0;
+
+    mark_point();
+    res = sqlconf_uri_urldecode(p, cases[i].src, cases[i].srcsz, &dst,
+      &dstsz);
+    fail_unless(res == 0, "Failed to handle src '%s': %s", cases[i].src,
+      strerror(errno));
+    fail_unless(strcmp(dst, cases[i].expected) == 0,
+      "Expected '%s', got '%s'", cases[i].expected, dst);
+    fail_unless(dstsz == strlen(cases[i].expected),
+      "Expected %lu for '%s', got %lu",
+      (unsigned long) strlen(cases[i].expected), cases[i].src,
+      (unsigned long) dstsz);
+  }
+}
+END_TEST
+
 Suite *tests_get_uri_suite(void) {
   Suite *suite;
   TCase *testcase;
@@ -637,6 +709,7 @@ Suite *tests_get_uri_suite(void) {
   tcase_add_test(testcase, uri_parse_real_uris_test);
 
   tcase_add_test(testcase, uri_urldecode_test);
+  tcase_add_test(testcase, uri_urldecode_escapes_test);
 
   suite_add_tcase(suite, testcase);
   return suite;
@@ -0,0 +1,219 @@
+#!/usr/bin/env perl
+
+use strict;
+
+use Cwd qw(abs_path realpath);
+use File::Basename qw(basename);
+use File::Spec;
+use File::Temp qw(tempdir);
+use Getopt::Long;
+use JSON::PP;
+use Time::HiRes qw(gettimeofday tv_interval);
+
+my $program = basename($0);
+
+my $opts = {};
+GetOptions($opts, 'depth=i', 'directives=i', 'fanout=i', 'h|help', 'keep',
+  'params=s', 'runs=i', 'seed=i', 'share=f', 'V|verbose', 'vhosts=i');
+
+usage() if $opts->{h};
+
+$opts->{runs} = 10 unless defined($opts->{runs});
+$opts->{vhosts} = 100 unless defined($opts->{vhosts});
+$opts->{depth} = 2 unless defined($opts->{depth});
+$opts->{directives} = 10 unless defined($opts->{directives});
+$opts->{fanout} = 1 unless defined($opts->{fanout});
+$opts->{share} = 0.5 unless defined($opts->{share});
+$opts->{seed} = 1 unless defined($opts->{seed});
+
+if ($opts->{runs} < 1) {
+  die "$program: --runs must be at least 1\n";
+}
+
+my $bench_dir = (File::Spec->splitpath(abs_path(__FILE__)))[1];
+
+unless (defined($ENV{PROFTPD_TEST_BIN})) {
+  my $bin = File::Spec->catfile($bench_dir, '..', '..', 'proftpd');
+  $ENV{PROFTPD_TEST_BIN} = realpath($bin);
+}
+my $proftpd = $ENV{PROFTPD_TEST_BIN};
+
+my $gen_conf = File::Spec->catfile($bench_dir, 'gen-conf.pl');
+my $db_script = realpath(File::Spec->catfile($bench_dir, '..', '..',
+  'sqlite-conf.sql'));
+
+my $tmpdir = tempdir("mod_conf_sql-bench-$$-XXXXXXXXXX",
+  TMPDIR => 1,
+  CLEANUP => $opts->{keep} ? 0 : 1,
+);
+
+my $sql_file = "$tmpdir/bench.sql";
+my $conf_file = "$tmpdir/bench.conf";
+my $db_file = "$tmpdir/bench.db";
+my $stats_file = "$tmpdir/stats.json";
+my $rss_file = "$tmpdir/rss";
+
+# Generate the configuration, in both forms.
+my $shape = {};
+my $gen_args = '';
+foreach my $opt (qw(vhosts depth directives fanout share seed)) {
+  $shape->{$opt} = $opts->{$opt} + 0;
+  $gen_args .= " --$opt=$opts->{$opt}";
+}
+
+run_cmd("$gen_conf$gen_args --sql=$sql_file --conf=$conf_file");
+run_cmd("sqlite3 $db_file < $db_script");
+run_cmd("sqlite3 $db_file < $sql_file");
+
+# GNU time, if present, reports the peak RSS of each run.
+my $time_cmd;
+if (system("/usr/bin/time -f %M -o $rss_file true > /dev/null 2>&1") == 0) {
+  $time_cmd = "/usr/bin/time -f %M -o $rss_file";
+}
+
+my $url = "sql://$db_file?stats=$stats_file";
+if (defined($opts->{params})) {
+  $url .= "&$opts->{params}";
+}
+
+my $results = {
+  proftpd => $proftpd,
+  runs => $opts->{runs},
+  shape => $shape,
+  sql => bench_conf("'$url'", 1),
+  file => bench_conf($conf_file, 0),
+};
+
+if ($results->{file}->{median_seconds} > 0) {
+  $results->{sql_to_file_ratio} = sprintf("%.3f",
+    $results->{sql}->{median_seconds} /
+    $results->{file}->{median_seconds}) + 0;
+}
+
+print STDOUT JSON::PP->new->canonical->pretty->encode($results);
+exit 0;
+
+sub bench_conf {
+  my ($conf, $use_stats) = @_;
+  my $cmd = "$proftpd -t -c $conf";
+  if (defined($time_cmd)) {
+    $cmd = "$time_cmd $cmd";
+  }
+
+  # One untimed run, to warm the page cache.
+  run_cmd($cmd);
+
+  my $secs = [];
+  my $rss_kb;
+  my $stats;
+
+  for (my $i = 0; $i < $opts->{runs}; $i++) {
+    my $start = [gettimeofday()];
+    run_cmd($cmd);
+    push(@$secs, tv_interval($start));
+
+    if (defined($time_cmd)) {
+      my $kb = read_file($rss_file);
+      chomp($kb);
+      if (!defined($rss_kb) || $kb > $rss_kb) {
+        $rss_kb = $kb + 0;
+      }
+    }
+
+    if ($use_stats) {
+      $stats = decode_json(read_file($stats_file));
+    }
+  }
+
+  my @sorted = sort { $a <=> $b } @$secs;
+  my $res = {
+    min_seconds => $sorted[0],
+    max_seconds => $sorted[-1],
+    median_seconds => percentile(\@sorted, 50),
+    p95_seconds => percentile(\@sorted, 95),
+    peak_rss_kb => $rss_kb,
+  };
+
+  if (defined($stats)) {
+    $res->{backend} = $stats->{backend};
+    $res->{queries} = $stats->{queries};
+    $res->{rows} = $stats->{rows};
+    $res->{contexts} = $stats->{contexts};
+    $res->{directives} = $stats->{directives};
+    $res->{memory_peak_bytes} = $stats->{memory_peak_bytes};
+  }
+
+  return $res;
+}
+
+# Uses the nearest-rank method; the list must be sorted.
+sub percentile {
+  my ($sorted, $pct) = @_;
+
+  my $rank = int(($pct / 100) * scalar(@$sorted) + 0.999999);
+  $rank = 1 if $rank < 1;
+  return $sorted->[$rank - 1];
+}
+
+sub read_file {
+  my $path = shift;
+
+  my $fh;
+  unless (open($fh, "< $path")) {
+    die "$program: unable to read $path: $!\n";
+  }
+
+  local $/;
+  my $data = <$fh>;
+  close($fh);
+
+  return $data;
+}
+
+sub run_cmd {
+  my $cmd = shift;
+
+  if ($opts->{V}) {
+    print STDERR "# Executing: $cmd\n";
+  }
+
+  my $output = `$cmd 2>&1`;
+  if ($? != 0) {
+    die "$program: '$cmd' failed with exit code $?:\n$output";
+  }
+
+  if ($opts->{V}) {
+    print STDERR "# Output: $output\n";
+  }
+
+  return 1;
+}
+
+sub usage {
+  print STDOUT <<EOH;
+
+usage: $program [options]
+
+Times 'proftpd -t' reading a generated configuration from SQLite, and the
+equivalent configuration file, reporting the results as JSON.  The proftpd
+binary is given by the PROFTPD_TEST_BIN environment variable.
+
+ Options:
+
+  --runs=N            Timed runs of each configuration (default 10)
+  --params=PARAMS     Additional SQL URI parameters, e.g. "native=false"
+  --keep              Keep the generated files
+  --verbose           Show the commands run, and their output
+
+ Generator options (see gen-conf.pl --help):
+
+  --vhosts=N --depth=D --directives=K --fanout=F --share=RATIO --seed=N
+
+Examples:
+
+  \$ perl $program --vhosts=1000 --depth=3 --runs=20
+  \$ make bench BENCH_OPTS="--vhosts=5000 --params=lookup=true"
+
+EOH
+  exit 0;
+}
@@ -0,0 +1,277 @@
+#!/usr/bin/env perl
+
+use strict;
+
+use File::Basename qw(basename);
+use Getopt::Long;
+
+my $program = basename($0);
+
+my $opts = {};
+GetOptions($opts, 'conf=s', 'depth=i', 'directives=i', 'fanout=i', 'h|help',
+  'seed=i', 'share=f', 'sql=s', 'vhosts=i');
+
+usage() if $opts->{h};
+
+$opts->{vhosts} = 100 unless defined($opts->{vhosts});
+$opts->{depth} = 2 unless defined($opts->{depth});
+$opts->{directives} = 10 unless defined($opts->{directives});
+$opts->{fanout} = 1 unless defined($opts->{fanout});
+$opts->{share} = 0.5 unless defined($opts->{share});
+$opts->{seed} = 1 unless defined($opts->{seed});
+
+unless (defined($opts->{sql}) || defined($opts->{conf})) {
+  die "$program: missing required --sql and/or --conf options\n";
+}
+
+# Only <VirtualHost>, <Directory> within it, and <Limit> within that, may be
+# nested; there is no deeper context chain which proftpd would accept.
+if ($opts->{depth} < 1 || $opts->{depth} > 3) {
+  die "$program: --depth must be between 1 and 3\n";
+}
+
+if ($opts->{share} < 0 || $opts->{share} > 1) {
+  die "$program: --share must be between 0 and 1\n";
+}
+
+# The directives used for each context type, with <VirtualHost> contexts
+# using those of the "server config" context; all of them may be repeated
+# within a context.  The values are made unique per row with a counter, so
+# that only rows deliberately shared are the same.
+my $directives = {
+  'default' => [
+    ['TimeoutIdle', '%u'],
+    ['TimeoutNoTransfer', '%u'],
+    ['MaxClients', '%u'],
+    ['AllowOverwrite', 'on'],
+    ['Umask', '022'],
+    ['DisplayLogin', '/etc/ftp/welcome.%u'],
+    ['ServerIdent', 'on "FTP server %u"'],
+    ['DefaultRoot', '~/%u'],
+  ],
+
+  'Directory' => [
+    ['AllowOverwrite', 'off'],
+    ['Umask', '027'],
+    ['HideNoAccess', 'on'],
+    ['HideFiles', '^\.bench%u$'],
+    ['DisplayChdir', '.message.%u'],
+    ['HideUser', 'bench%u'],
+  ],
+
+  'Limit' => [
+    ['AllowUser', 'bench%u'],
+    ['DenyUser', 'nobody%u'],
+    ['AllowGroup', 'bench%u'],
+    ['DenyGroup', 'nogroup%u'],
+  ],
+};
+
+my $limit_cmds = [qw(READ WRITE DIRS STOR RETR MKD RMD DELE)];
+
+srand($opts->{seed});
+
+my $next_ctx_id = 1;
+my $next_conf_id = 1;
+my $confs = [];
+my $conf_ids = {};
+my $nmaps = 0;
+
+my $base_ctx = new_ctx('default', undef, undef);
+
+for (my $i = 0; $i < $opts->{vhosts}; $i++) {
+  # Skip 127.0.0.1, and keep each address unique.
+  my $n = $i + 2;
+  my $addr = sprintf("127.%u.%u.%u", ($n >> 16) & 255, ($n >> 8) & 255,
+    $n & 255);
+
+  my $vhost_ctx = new_ctx('VirtualHost', $addr, $base_ctx);
+
+  next unless $opts->{depth} > 1;
+
+  for (my $j = 0; $j < $opts->{fanout}; $j++) {
+    my $dir_ctx = new_ctx('Directory', "/srv/bench/v$i/d$j", $vhost_ctx);
+
+    next unless $opts->{depth} > 2;
+
+    for (my $k = 0; $k < $opts->{fanout}; $k++) {
+      my $cmd = $limit_cmds->[$k % scalar(@$limit_cmds)];
+      new_ctx('Limit', $cmd, $dir_ctx);
+    }
+  }
+}
+
+if (defined($opts->{sql})) {
+  write_sql($opts->{sql});
+}
+
+if (defined($opts->{conf})) {
+  write_conf($opts->{conf});
+}
+
+printf STDOUT "%s: %u contexts, %u directives (%u distinct rows)\n",
+  $program, $next_ctx_id - 1, $nmaps, scalar(@$confs);
+
+exit 0;
+
+sub new_ctx {
+  my ($type, $value, $parent) = @_;
+
+  my $ctx = {
+    id => $next_ctx_id++,
+    type => $type,
+    value => $value,
+    conf_ids => [],
+    contexts => [],
+  };
+
+  for (my $i = 0; $i < $opts->{directives}; $i++) {
+    push(@{ $ctx->{conf_ids} }, get_conf_id($type));
+    $nmaps++;
+  }
+
+  if (defined($parent)) {
+    $ctx->{parent_id} = $parent->{id};
+    push(@{ $parent->{contexts} }, $ctx);
+  }
+
+  return $ctx;
+}
+
+sub get_conf_id {
+  my $type = shift;
+
+  # The "server config" and <VirtualHost> contexts share their directives.
+  my $key = ($type eq 'VirtualHost') ? 'default' : $type;
+
+  # Reuse an existing row, of a directive valid in this type of context, for
+  # the requested share of the directives.
+  my $ids = $conf_ids->{$key};
+  if (defined($ids) &&
+      rand() < $opts->{share}) {
+    return $ids->[int(rand(scalar(@$ids)))];
+  }
+
+  my $list = $directives->{$key};
+  my $directive = $list->[int(rand(scalar(@$list)))];
+
+  my $conf_id = $next_conf_id++;
+  push(@$confs, {
+    id => $conf_id,
+    name => $directive->[0],
+    value => sprintf($directive->[1], $conf_id),
+  });
+  push(@{ $conf_ids->{$key} }, $conf_id);
+
+  return $conf_id;
+}
+
+sub sql_quote {
+  my $val = shift;
+  return 'NULL' unless defined($val);
+
+  $val =~ s/'/''/g;
+  return "'$val'";
+}
+
+sub write_sql_ctx {
+  my ($fh, $ctx) = @_;
+
+  print $fh "INSERT INTO ftpctx (id, parent_id, name, type, value) VALUES ($ctx->{id}, ",
+    (defined($ctx->{parent_id}) ? $ctx->{parent_id} : 'NULL'), ", ",
+    sql_quote(defined($ctx->{parent_id}) ? undef : "ctx$ctx->{id}"), ", ",
+    sql_quote($ctx->{type}), ", ", sql_quote($ctx->{value}), ");\n";
+
+  foreach my $conf_id (@{ $ctx->{conf_ids} }) {
+    print $fh "INSERT INTO ftpmap (conf_id, ctx_id) VALUES ($conf_id, $ctx->{id});\n";
+  }
+
+  foreach my $sub_ctx (@{ $ctx->{contexts} }) {
+    write_sql_ctx($fh, $sub_ctx);
+  }
+}
+
+sub write_sql {
+  my $path = shift;
+
+  my $fh;
+  unless (open($fh, "> $path")) {
+    die "$program: unable to open $path: $!\n";
+  }
+
+  print $fh "BEGIN TRANSACTION;\n";
+
+  foreach my $conf (@$confs) {
+    print $fh "INSERT INTO ftpconf (id, name, value) VALUES ($conf->{id}, ",
+      sql_quote($conf->{name}), ", ", sql_quote($conf->{value}), ");\n";
+  }
+
+  write_sql_ctx($fh, $base_ctx);
+
+  print $fh "COMMIT;\n";
+
+  unless (close($fh)) {
+    die "$program: unable to write $path: $!\n";
+  }
+}
+
+sub write_conf_ctx {
+  my ($fh, $ctx, $indent) = @_;
+
+  foreach my $conf_id (@{ $ctx->{conf_ids} }) {
+    my $conf = $confs->[$conf_id - 1];
+    print $fh "$indent$conf->{name} $conf->{value}\n";
+  }
+
+  foreach my $sub_ctx (@{ $ctx->{contexts} }) {
+    print $fh "$indent<$sub_ctx->{type} $sub_ctx->{value}>\n";
+    write_conf_ctx($fh, $sub_ctx, "$indent  ");
+    print $fh "$indent</$sub_ctx->{type}>\n";
+  }
+}
+
+sub write_conf {
+  my $path = shift;
+
+  my $fh;
+  unless (open($fh, "> $path")) {
+    die "$program: unable to open $path: $!\n";
+  }
+
+  write_conf_ctx($fh, $base_ctx, '');
+
+  unless (close($fh)) {
+    die "$program: unable to write $path: $!\n";
+  }
+}
+
+sub usage {
+  print STDOUT <<EOH;
+
+usage: $program [options]
+
+Generates a synthetic configuration, as SQL statements for the tables created
+by sqlite-conf.sql, and/or as the equivalent proftpd.conf file.
+
+ Options:
+
+  --sql=PATH          Write the SQL statements to PATH
+  --conf=PATH         Write the equivalent configuration file to PATH
+  --vhosts=N          Number of <VirtualHost> contexts (default 100)
+  --depth=D           Context depth below "server config": 1 for
+                      <VirtualHost> only, 2 to add <Directory>, and 3 to
+                      add <Limit> (default 2)
+  --directives=K      Directives per context (default 10)
+  --fanout=F          <Directory> contexts per <VirtualHost>, and <Limit>
+                      contexts per <Directory> (default 1)
+  --share=RATIO       Fraction of directives reusing an existing ftpconf row,
+                      from 0 to 1 (default 0.5)
+  --seed=N            Random seed, for reproducible output (default 1)
+
+Examples:
+
+  \$ perl $program --vhosts=1000 --depth=3 --sql=bench.sql --conf=bench.conf
+
+EOH
+  exit 0;
+}
@@ -0,0 +1,385 @@
+/*
+ * ProFTPD - mod_conf_sql fuzzing harness
+ * Copyright (c) 2016 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* URI and parameter parser fuzzing, for both crashes and super-linear
+ * parse times.
+ *
+ * The first byte of each input selects the parser, and the rest is its
+ * input.  Each input's body is then repeated until parsing it takes long
+ * enough to be timed reliably, and parsed again with that body repeated
+ * FUZZ_SCALE times more; a linear parser takes about the same time per byte
+ * for both.  When the cost per byte of the larger input exceeds that of the
+ * smaller by more than the allowed ratio (CONF_SQL_FUZZ_MAX_RATIO, default
+ * 2.0), the input is reported, and the harness aborts so that the fuzzer
+ * keeps it; set CONF_SQL_FUZZ_NO_ABORT to only report such inputs.
+ *
+ * This file provides LLVMFuzzerTestOneInput(), for libFuzzer, or AFL++
+ * via its libFuzzer driver.  When built with CONF_SQL_FUZZ_STANDALONE, it
+ * instead runs each file named on the command line (or stdin), e.g. for
+ * AFL in its classic mode, or for replaying a corpus.
+ */
+
+#include "mod_conf_sql.h"
+#include "uri.h"
+#include "param.h"
+
+/* How many times more the input body is repeated, for each larger parse. */
+#define FUZZ_SCALE			4
+
+/* How many times each parse is timed, keeping the fastest. */
+#define FUZZ_NRUNS			3
+
+/* Parses faster than this are too noisy to judge; inputs are scaled up
+ * until they take at least this long, but no larger than the maximum size.
+ */
+#define FUZZ_MIN_SCALED_NSECS		(100 * 1000)
+#define FUZZ_MAX_SCALED_LEN		(1024 * 1024)
+
+#define FUZZ_DEFAULT_MAX_RATIO		2.0
+
+struct fuzz_target {
+  const char *name;
+  int (*parse)(pool *p, const char *input, size_t inputsz);
+
+  /* Inputs are scaled by repeating the text after this separator, joined
+   * by the separator, or the whole input if NULL or not found.
+   */
+  const char *scale_sep;
+
+  /* The worst ratio of scaled to original per-byte cost seen. */
+  double max_ratio;
+};
+
+static double fuzz_max_ratio = 0.0;
+static int fuzz_abort = TRUE;
+
+static uint64_t fuzz_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+static int fuzz_uri_parse(pool *p, const char *input, size_t inputsz) {
+  char *host = NULL, *path = NULL, *username = NULL, *password = NULL;
+  unsigned int port = 0;
+
+  return sqlconf_uri_parse(p, input, &host, &port, &path, &username,
+    &password, pr_table_alloc(p, 0));
+}
+
+static int fuzz_uri_urldecode(pool *p, const char *input, size_t inputsz) {
+  char *dst = NULL;
+  size_t dstsz = 0;
+
+  return sqlconf_uri_urldecode(p, input, inputsz, &dst, &dstsz);
+}
+
+static pr_table_t *fuzz_params(pool *p, const char *key, const char *val) {
+  pr_table_t *params;
+
+  params = pr_table_alloc(p, 0);
+  (void) pr_table_add(params, key, val, 0);
+  return params;
+}
+
+static int fuzz_param_parse_conf(pool *p, const char *input, size_t inputsz) {
+  char *table, *id_col, *name_col, *value_col, *where;
+
+  return sqlconf_param_parse_conf(p, fuzz_params(p, "conf", input), &table,
+    &id_col, &name_col, &value_col, &where);
+}
+
+static int fuzz_param_parse_ctx(pool *p, const char *input, size_t inputsz) {
+  char *table, *id_col, *parent_id_col, *type_col, *value_col, *where;
+
+  return sqlconf_param_parse_ctx(p, fuzz_params(p, "ctx", input), &table,
+    &id_col, &parent_id_col, &type_col, &value_col, &where);
+}
+
+static int fuzz_param_parse_map(pool *p, const char *input, size_t inputsz) {
+  char *table, *conf_id_col, *ctx_id_col, *where;
+
+  return sqlconf_param_parse_map(p, fuzz_params(p, "map", input), &table,
+    &conf_id_col, &ctx_id_col, &where);
+}
+
+static int fuzz_param_parse_argv(pool *p, const char *input, size_t inputsz) {
+  char *argv_col, *separator;
+
+  return sqlconf_param_parse_argv(p, fuzz_params(p, "argv", input),
+    &argv_col, &separator);
+}
+
+static struct fuzz_target fuzz_targets[] = {
+  { "uri_parse",	fuzz_uri_parse,		"&",	0.0 },
+  { "uri_urldecode",	fuzz_uri_urldecode,	NULL,	0.0 },
+  { "param_parse_conf",	fuzz_param_parse_conf,	":",	0.0 },
+  { "param_parse_ctx",	fuzz_param_parse_ctx,	":",	0.0 },
+  { "param_parse_map",	fuzz_param_parse_map,	":",	0.0 },
+  { "param_parse_argv",	fuzz_param_parse_argv,	":",	0.0 },
+
+  { NULL, NULL, NULL, 0.0 }
+};
+
+#define FUZZ_NTARGETS \
+  ((sizeof(fuzz_targets) / sizeof(struct fuzz_target)) - 1)
+
+/* Returns the given input, with its body repeated the given number of
+ * times, or NULL if that would exceed the maximum size.
+ */
+static char *fuzz_scale(pool *p, const struct fuzz_target *target,
+    const char *input, size_t count) {
+  register size_t i;
+  const char *body = NULL;
+  char *res, *ptr;
+  size_t inputsz, bodysz;
+
+  if (target->scale_sep != NULL) {
+    body = strstr(input, target->scale_sep);
+  }
+
+  if (body == NULL) {
+    body = input;
+  }
+
+  inputsz = strlen(input);
+  bodysz = strlen(body);
+
+  if (bodysz > 0 &&
+      count - 1 > (FUZZ_MAX_SCALED_LEN - inputsz) / bodysz) {
+    return NULL;
+  }
+
+  res = ptr = palloc(p, inputsz + ((count - 1) * bodysz) + 1);
+
+  memcpy(ptr, input, inputsz);
+  ptr += inputsz;
+
+  for (i = 1; i < count; i++) {
+    memcpy(ptr, body, bodysz);
+    ptr += bodysz;
+  }
+
+  *ptr = '\0';
+  return res;
+}
+
+/* Returns the fastest of several parses of the given input, in
+ * nanoseconds.
+ */
+static uint64_t fuzz_time(pool *p, const struct fuzz_target *target,
+    const char *input) {
+  register unsigned int i;
+  uint64_t best_ns = 0;
+  size_t inputsz;
+
+  inputsz = strlen(input);
+
+  for (i = 0; i < FUZZ_NRUNS; i++) {
+    pool *tmp_pool;
+    uint64_t start_ns, elapsed_ns;
+
+    tmp_pool = make_sub_pool(p);
+    start_ns = fuzz_now();
+    (void) target->parse(tmp_pool, input, inputsz);
+    elapsed_ns = fuzz_now() - start_ns;
+    destroy_pool(tmp_pool);
+
+    if (i == 0 ||
+        elapsed_ns < best_ns) {
+      best_ns = elapsed_ns;
+    }
+  }
+
+  return best_ns;
+}
+
+static void fuzz_init(void) {
+  const char *env;
+
+  fuzz_max_ratio = FUZZ_DEFAULT_MAX_RATIO;
+
+  env = getenv("CONF_SQL_FUZZ_MAX_RATIO");
+  if (env != NULL) {
+    fuzz_max_ratio = atof(env);
+    if (fuzz_max_ratio <= 1.0) {
+      fuzz_max_ratio = FUZZ_DEFAULT_MAX_RATIO;
+    }
+  }
+
+  if (getenv("CONF_SQL_FUZZ_NO_ABORT") != NULL) {
+    fuzz_abort = FALSE;
+  }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t datasz) {
+  struct fuzz_target *target;
+  pool *p;
+  char *input, *base, *scaled;
+  size_t count, basesz, scaledsz;
+  uint64_t base_ns, scaled_ns;
+  double ratio;
+
+  if (fuzz_max_ratio == 0.0) {
+    fuzz_init();
+  }
+
+  if (datasz < 1) {
+    return 0;
+  }
+
+  target = &(fuzz_targets[data[0] % FUZZ_NTARGETS]);
+
+  p = make_sub_pool(NULL);
+
+  /* The parsers take NUL-terminated strings; anything past an embedded NUL
+   * is ignored by them too.
+   */
+  input = pstrndup(p, (const char *) data + 1, datasz - 1);
+
+  /* Crashes, and sanitizer findings, are caught by this first parse. */
+  (void) target->parse(p, input, strlen(input));
+
+  if (*input == '\0') {
+    destroy_pool(p);
+    return 0;
+  }
+
+  /* Scale the input up until its parse time can be judged. */
+  count = 1;
+  base = input;
+  base_ns = fuzz_time(p, target, base);
+
+  while (base_ns < FUZZ_MIN_SCALED_NSECS) {
+    count *= FUZZ_SCALE;
+
+    base = fuzz_scale(p, target, input, count);
+    if (base == NULL) {
+      /* Too fast to judge, even at the maximum size. */
+      destroy_pool(p);
+      return 0;
+    }
+
+    base_ns = fuzz_time(p, target, base);
+  }
+
+  scaled = fuzz_scale(p, target, input, count * FUZZ_SCALE);
+  if (scaled == NULL) {
+    destroy_pool(p);
+    return 0;
+  }
+
+  basesz = strlen(base);
+  scaledsz = strlen(scaled);
+  scaled_ns = fuzz_time(p, target, scaled);
+
+  ratio = ((double) scaled_ns / scaledsz) / ((double) base_ns / basesz);
+
+  if (ratio > target->max_ratio) {
+    target->max_ratio = ratio;
+    fprintf(stderr, "%s: new worst per-byte cost ratio %.2f "
+      "(%lu bytes: %.1f ns/byte, %lu bytes: %.1f ns/byte)\n", target->name,
+      ratio, (unsigned long) basesz, (double) base_ns / basesz,
+      (unsigned long) scaledsz, (double) scaled_ns / scaledsz);
+  }
+
+  if (ratio > fuzz_max_ratio) {
+    fprintf(stderr, "%s: super-linear parse time: per-byte cost grew %.2fx "
+      "(allowed %.2fx) for %lux the input\n", target->name, ratio,
+      fuzz_max_ratio, (unsigned long) FUZZ_SCALE);
+
+    if (fuzz_abort == TRUE) {
+      abort();
+    }
+  }
+
+  destroy_pool(p);
+  return 0;
+}
+
+#ifdef CONF_SQL_FUZZ_STANDALONE
+static int fuzz_file(FILE *fh) {
+  uint8_t *data = NULL;
+  size_t datasz = 0, alloced = 0;
+
+  while (!feof(fh)) {
+    size_t nread;
+
+    if (datasz == alloced) {
+      uint8_t *new_data;
+
+      alloced = alloced ? alloced * 2 : 4096;
+      new_data = realloc(data, alloced);
+      if (new_data == NULL) {
+        free(data);
+        return -1;
+      }
+
+      data = new_data;
+    }
+
+    nread = fread(data + datasz, 1, alloced - datasz, fh);
+    if (nread == 0 &&
+        ferror(fh)) {
+      free(data);
+      return -1;
+    }
+
+    datasz += nread;
+  }
+
+  (void) LLVMFuzzerTestOneInput(data, datasz);
+  free(data);
+
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  register int i;
+  int res = 0;
+
+  if (argc < 2) {
+    return fuzz_file(stdin) < 0 ? 1 : 0;
+  }
+
+  for (i = 1; i < argc; i++) {
+    FILE *fh;
+
+    fh = fopen(argv[i], "r");
+    if (fh == NULL ||
+        fuzz_file(fh) < 0) {
+      fprintf(stderr, "%s: error reading '%s': %s\n", argv[0], argv[i],
+        strerror(errno));
+      res = 1;
+    }
+
+    if (fh != NULL) {
+      fclose(fh);
+    }
+  }
+
+  return res;
+}
+#endif /* CONF_SQL_FUZZ_STANDALONE */
@@ -6,7 +6,7 @@ use Carp;
 use Cwd qw(abs_path realpath);
 use File::Path qw(mkpath rmtree);
 use File::Spec;
-use Test::Simple tests => 8;
+use Test::Simple tests => 13;
 
 # Note: We COULD honor/use the TEST_VERBOSE environment variable here, but
 # this separate variable makes for a per-db verbose flag.
@@ -91,6 +91,41 @@ eval { $res = run_cmd($cmd, 1) };
 $ex = $@ if $@;
 ok($res && !defined($ex), "read valid config from complex Postgres URL");
 
+my $copy_url = "$complex_url&copy=true";
+$cmd = "$proftpd $proftpd_opts -c '$copy_url'";
+$ex = undef;
+eval { $res = run_cmd($cmd, 1) };
+$ex = $@ if $@;
+ok($res && !defined($ex), "read valid config from Postgres URL via COPY");
+
+my $pipeline_url = "$complex_url&pipeline=true";
+$cmd = "$proftpd $proftpd_opts -c '$pipeline_url'";
+$ex = undef;
+eval { $res = run_cmd($cmd, 1) };
+$ex = $@ if $@;
+ok($res && !defined($ex), "read valid config from Postgres URL via pipeline");
+
+# Malformed directive rows, such as those with NULL names, are skipped the
+# same way whether the configuration is copied or pipelined.
+my $null_name_sql = "ALTER TABLE ftpconf ALTER COLUMN name DROP NOT NULL; INSERT INTO ftpconf (name, value) VALUES (NULL, 'on'); INSERT INTO ftpmap (conf_id, ctx_id) SELECT currval('ftpconf_id_seq'), id FROM ftpctx WHERE parent_id IS NULL;";
+$cmd = "psql -U $username -w -d $dbname -c \"$null_name_sql\"";
+$ex = undef;
+eval { $res = run_cmd($cmd, 1) };
+$ex = $@ if $@;
+ok($res && !defined($ex), "added NULL-name directive to Postgres database");
+
+$cmd = "$proftpd $proftpd_opts -c '$copy_url'";
+$ex = undef;
+eval { $res = run_cmd($cmd, 1) };
+$ex = $@ if $@;
+ok($res && !defined($ex), "skipped NULL-name directive via COPY");
+
+$cmd = "$proftpd $proftpd_opts -c '$pipeline_url'";
+$ex = undef;
+eval { $res = run_cmd($cmd, 1) };
+$ex = $@ if $@;
+ok($res && !defined($ex), "skipped NULL-name directive via pipeline");
+
 # XXX Last, empty/restore the db file, and populate it with BAD config
 
 sub run_cmd {
@@ -6,7 +6,7 @@ use Carp;
 use Cwd qw(abs_path realpath);
 use File::Path qw(mkpath rmtree);
 use File::Spec;
-use Test::Simple tests => 8;
+use Test::Simple tests => 11;
 
 # Note: We COULD honor/use the TEST_VERBOSE environment variable here, but
 # this separate variable makes for a per-db verbose flag.
@@ -52,7 +52,10 @@ eval { $res = run_cmd($cmd, 1) };
 $ex = $@ if $@;
 ok($res && !defined($ex), "read empty config from simple SQLite URL again");
 
-my $complex_url = "sql://$db_file?tracing=$tracing&driver=sqlite&ctx=ftpctx:id,parent_id,type,value&map=ftpmap:conf_id,ctx_id&conf=ftpconf:id,name,value";
+# The complex URL is pinned to mod_sql, which would otherwise be bypassed by
+# the native SQLite reader.
+my $complex_stats = "$tmpdir/complex-stats.json";
+my $complex_url = "sql://$db_file?tracing=$tracing&driver=sqlite&native=false&stats=$complex_stats&ctx=ftpctx:id,parent_id,type,value&map=ftpmap:conf_id,ctx_id&conf=ftpconf:id,name,value";
 $cmd = "$proftpd $proftpd_opts -c '$complex_url'";
 $ex = undef;
 eval { $res = run_cmd($cmd, 1) };
@@ -87,9 +90,44 @@ $ex = undef;
 eval { $res = run_cmd($cmd, 1) };
 $ex = $@ if $@;
 ok($res && !defined($ex), "read valid config from complex SQLite URL");
+ok(stats_backend($complex_stats) eq 'mod_sql',
+  "read complex SQLite URL via mod_sql");
+
+my $native_stats = "$tmpdir/native-stats.json";
+my $native_url = "sql://$db_file?tracing=$tracing&stats=$native_stats&immutable=true&mmap_size=1048576&query_only=true&ctx=ftpctx:id,parent_id,type,value&map=ftpmap:conf_id,ctx_id&conf=ftpconf:id,name,value";
+$cmd = "$proftpd $proftpd_opts -c '$native_url'";
+$ex = undef;
+eval { $res = run_cmd($cmd, 1) };
+$ex = $@ if $@;
+ok($res && !defined($ex), "read valid config from native SQLite URL");
+ok(stats_backend($native_stats) eq 'sqlite',
+  "read native SQLite URL via libsqlite3");
 
 # XXX Last, empty/restore the db file, and populate it with BAD config
 
+# Returns the backend which served the load, from its stats file.
+sub stats_backend {
+  my $path = shift;
+  my $backend = '';
+
+  if (open(my $fh, '<', $path)) {
+    while (my $line = <$fh>) {
+      if ($line =~ /"backend":\s*"([^"]*)"/) {
+        $backend = $1;
+        last;
+      }
+    }
+
+    close($fh);
+  }
+
+  if ($debug) {
+    print STDOUT "# Backend ($path): $backend\n";
+  }
+
+  return $backend;
+}
+
 sub run_cmd {
   my $cmd = shift;
   my $check_exit_status = shift;
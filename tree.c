@@ -0,0 +1,556 @@
+/*
+ * ProFTPD - mod_conf_sql in-memory configuration tree implementation
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+#include "tree.h"
+
+struct sqlconf_tree_ctx {
+  int id;
+  const char *idstr;
+
+  /* Contexts may be referenced, as parents, before their own rows have been
+   * seen.
+   */
+  int defined;
+  int matched;
+  const char *type;
+  const char *value;
+
+  /* Directive rows, stored flattened, as mod_sql returns them. */
+  array_header *confs;
+
+  array_header *children;
+};
+
+struct sqlconf_tree_st {
+  pool *pool;
+  int flags;
+
+  /* Contexts, keyed by ID. */
+  pr_table_t *ctxs;
+
+  /* Toplevel contexts. */
+  array_header *roots;
+
+  unsigned int nconfs;
+
+  /* Bytes allocated for contexts and directives. */
+  size_t nbytes;
+};
+
+/* The hash chain count for the context table; configurations with many
+ * thousands of contexts are expected.
+ */
+#define CONF_SQL_TREE_NCHAINS		1024
+
+static const char *trace_channel = "conf_sql";
+
+static int tree_parse_id(const char *text, int *id) {
+  char *ptr = NULL;
+  long val;
+
+  if (text == NULL ||
+      *text == '\0') {
+    errno = EINVAL;
+    return -1;
+  }
+
+  val = strtol(text, &ptr, 10);
+  if (ptr == NULL ||
+      *ptr != '\0' ||
+      val < INT_MIN ||
+      val > INT_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  *id = (int) val;
+  return 0;
+}
+
+/* The context table is keyed by the binary IDs; the table's default key
+ * hash and comparison treat keys as strings, and would stop at the first
+ * NUL byte, making e.g. IDs 256 and 512 the same key.
+ */
+static unsigned int tree_id_hash(const void *key, size_t keysz) {
+  unsigned int id;
+
+  id = (unsigned int) *((const int *) key);
+
+  /* Spread sequential IDs across the chains. */
+  return id * 2654435761U;
+}
+
+static int tree_id_cmp(const void *key1, size_t keysz1, const void *key2,
+    size_t keysz2) {
+  int id1, id2;
+
+  if (keysz1 != keysz2) {
+    return keysz1 < keysz2 ? -1 : 1;
+  }
+
+  id1 = *((const int *) key1);
+  id2 = *((const int *) key2);
+
+  if (id1 == id2) {
+    return 0;
+  }
+
+  return id1 < id2 ? -1 : 1;
+}
+
+static struct sqlconf_tree_ctx *tree_get_ctx(sqlconf_tree_t *tree, int id) {
+  struct sqlconf_tree_ctx *ctx;
+
+  ctx = (struct sqlconf_tree_ctx *) pr_table_kget(tree->ctxs, &id, sizeof(int),
+    NULL);
+  return ctx;
+}
+
+/* Look up the context with the given ID, creating a placeholder for it if
+ * it has not been seen yet.
+ */
+static struct sqlconf_tree_ctx *tree_lookup_ctx(sqlconf_tree_t *tree,
+    int id) {
+  struct sqlconf_tree_ctx *ctx;
+  char idstr[32];
+
+  ctx = tree_get_ctx(tree, id);
+  if (ctx != NULL) {
+    return ctx;
+  }
+
+  ctx = pcalloc(tree->pool, sizeof(struct sqlconf_tree_ctx));
+  ctx->id = id;
+
+  memset(idstr, '\0', sizeof(idstr));
+  snprintf(idstr, sizeof(idstr)-1, "%d", id);
+  ctx->idstr = pstrdup(tree->pool, idstr);
+
+  tree->nbytes += sizeof(struct sqlconf_tree_ctx) + strlen(idstr) + 1;
+
+  if (pr_table_kadd(tree->ctxs, &(ctx->id), sizeof(int), ctx,
+      sizeof(struct sqlconf_tree_ctx *)) < 0) {
+    return NULL;
+  }
+
+  return ctx;
+}
+
+sqlconf_tree_t *sqlconf_tree_create(pool *p, int flags) {
+  sqlconf_tree_t *tree;
+  int max_ents = INT_MAX;
+
+  if (p == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  tree = pcalloc(p, sizeof(sqlconf_tree_t));
+  tree->pool = p;
+  tree->flags = flags;
+  tree->ctxs = pr_table_nalloc(p, 0, CONF_SQL_TREE_NCHAINS);
+  (void) pr_table_ctl(tree->ctxs, PR_TABLE_CTL_SET_MAX_ENTS, &max_ents);
+  (void) pr_table_ctl(tree->ctxs, PR_TABLE_CTL_SET_KEY_HASH,
+    (void *) tree_id_hash);
+  (void) pr_table_ctl(tree->ctxs, PR_TABLE_CTL_SET_KEY_CMP,
+    (void *) tree_id_cmp);
+  tree->roots = make_array(p, 1, sizeof(struct sqlconf_tree_ctx *));
+
+  return tree;
+}
+
+int sqlconf_tree_add_ctx(sqlconf_tree_t *tree, const char *id,
+    const char *parent_id, const char *type, const char *value, int matched) {
+  int ctx_id;
+  struct sqlconf_tree_ctx *ctx;
+
+  if (tree == NULL ||
+      id == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (tree_parse_id(id, &ctx_id) < 0) {
+    pr_trace_msg(trace_channel, 3, "ignoring context with invalid ID '%s'",
+      id);
+    errno = EINVAL;
+    return -1;
+  }
+
+  ctx = tree_lookup_ctx(tree, ctx_id);
+  if (ctx == NULL) {
+    return -1;
+  }
+
+  if (ctx->defined == TRUE) {
+    pr_trace_msg(trace_channel, 3, "ignoring duplicate context ID %d",
+      ctx_id);
+    errno = EEXIST;
+    return -1;
+  }
+
+  ctx->defined = TRUE;
+  ctx->matched = matched;
+  ctx->type = type != NULL ? pstrdup(tree->pool, type) : "";
+  ctx->value = value != NULL ? pstrdup(tree->pool, value) : "";
+  tree->nbytes += strlen(ctx->type) + strlen(ctx->value) + 2;
+
+  if (parent_id == NULL) {
+    *((struct sqlconf_tree_ctx **) push_array(tree->roots)) = ctx;
+
+  } else {
+    int pctx_id;
+    struct sqlconf_tree_ctx *pctx;
+
+    if (tree_parse_id(parent_id, &pctx_id) < 0) {
+      pr_trace_msg(trace_channel, 3,
+        "context ID %d has invalid parent ID '%s'", ctx_id, parent_id);
+      errno = EINVAL;
+      return -1;
+    }
+
+    pctx = tree_lookup_ctx(tree, pctx_id);
+    if (pctx == NULL) {
+      return -1;
+    }
+
+    if (pctx->children == NULL) {
+      pctx->children = make_array(tree->pool, 1,
+        sizeof(struct sqlconf_tree_ctx *));
+    }
+
+    *((struct sqlconf_tree_ctx **) push_array(pctx->children)) = ctx;
+    tree->nbytes += sizeof(struct sqlconf_tree_ctx *);
+  }
+
+  return 0;
+}
+
+int sqlconf_tree_add_conf(sqlconf_tree_t *tree, const char *ctx_id,
+    const char *name, const char *value, const char *argv_text) {
+  int id;
+  struct sqlconf_tree_ctx *ctx;
+
+  if (tree == NULL ||
+      ctx_id == NULL ||
+      name == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (tree_parse_id(ctx_id, &id) < 0) {
+    pr_trace_msg(trace_channel, 3,
+      "ignoring directive '%s' with invalid context ID '%s'", name, ctx_id);
+    errno = EINVAL;
+    return -1;
+  }
+
+  ctx = tree_lookup_ctx(tree, id);
+  if (ctx == NULL) {
+    return -1;
+  }
+
+  if (ctx->confs == NULL) {
+    ctx->confs = make_array(tree->pool, 2, sizeof(char *));
+  }
+
+  *((char **) push_array(ctx->confs)) = pstrdup(tree->pool, name);
+  *((char **) push_array(ctx->confs)) = value != NULL ?
+    pstrdup(tree->pool, value) : "";
+  tree->nbytes += (sizeof(char *) * 2) + strlen(name) + 1 +
+    (value != NULL ? strlen(value) + 1 : 0);
+
+  if (tree->flags & CONF_SQL_TREE_FL_ARGV) {
+    *((char **) push_array(ctx->confs)) = argv_text != NULL ?
+      pstrdup(tree->pool, argv_text) : "";
+    tree->nbytes += sizeof(char *) +
+      (argv_text != NULL ? strlen(argv_text) + 1 : 0);
+  }
+
+  tree->nconfs++;
+  return 0;
+}
+
+int sqlconf_tree_select(pool *p, sqlconf_tree_t *tree, unsigned int shape,
+    int ctx_id, const char *base_id, sql_data_t **sd) {
+  register unsigned int i;
+  struct sqlconf_tree_ctx *ctx = NULL, **ctxs;
+  array_header *values = NULL;
+  sql_data_t *data;
+
+  if (p == NULL ||
+      tree == NULL ||
+      shape > CONF_SQL_QUERY_MAX ||
+      sd == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  data = pcalloc(p, sizeof(sql_data_t));
+
+  switch (shape) {
+    case CONF_SQL_QUERY_BASE_CTX:
+      data->fnum = 1;
+      values = make_array(p, 1, sizeof(char *));
+
+      if (base_id != NULL) {
+        int id;
+
+        if (tree_parse_id(base_id, &id) == 0) {
+          ctx = tree_get_ctx(tree, id);
+          if (ctx != NULL &&
+              ctx->defined == TRUE) {
+            *((const char **) push_array(values)) = ctx->idstr;
+          }
+        }
+
+      } else {
+        ctxs = tree->roots->elts;
+        for (i = 0; i < tree->roots->nelts; i++) {
+          *((const char **) push_array(values)) = ctxs[i]->idstr;
+        }
+      }
+
+      data->rnum = values->nelts;
+      break;
+
+    case CONF_SQL_QUERY_CTX:
+      data->fnum = 2;
+      values = make_array(p, 2, sizeof(char *));
+
+      ctx = tree_get_ctx(tree, ctx_id);
+      if (ctx != NULL &&
+          ctx->defined == TRUE &&
+          ctx->matched == TRUE) {
+        *((const char **) push_array(values)) = ctx->type;
+        *((const char **) push_array(values)) = ctx->value;
+        data->rnum = 1;
+      }
+      break;
+
+    case CONF_SQL_QUERY_CONFS:
+      data->fnum = (tree->flags & CONF_SQL_TREE_FL_ARGV) ? 3 : 2;
+
+      ctx = tree_get_ctx(tree, ctx_id);
+      if (ctx != NULL &&
+          ctx->confs != NULL) {
+        /* The rows are already laid out as mod_sql would return them. */
+        data->rnum = ctx->confs->nelts / data->fnum;
+        data->data = ctx->confs->elts;
+
+      } else {
+        values = make_array(p, 1, sizeof(char *));
+      }
+      break;
+
+    case CONF_SQL_QUERY_CHILD_CTXS:
+      data->fnum = 1;
+      values = make_array(p, 1, sizeof(char *));
+
+      ctx = tree_get_ctx(tree, ctx_id);
+      if (ctx != NULL &&
+          ctx->children != NULL) {
+        ctxs = ctx->children->elts;
+        for (i = 0; i < ctx->children->nelts; i++) {
+          if (ctxs[i]->matched == TRUE) {
+            *((const char **) push_array(values)) = ctxs[i]->idstr;
+          }
+        }
+      }
+
+      data->rnum = values->nelts;
+      break;
+  }
+
+  if (values != NULL) {
+    data->data = values->elts;
+  }
+
+  *sd = data;
+  return 0;
+}
+
+size_t sqlconf_tree_get_size(sqlconf_tree_t *tree) {
+  if (tree == NULL) {
+    errno = EINVAL;
+    return 0;
+  }
+
+  return tree->nbytes;
+}
+
+static int tree_unescape_field(char *field, size_t len) {
+  char *src, *dst, *end;
+
+  src = dst = field;
+  end = field + len;
+
+  while (src < end) {
+    char c;
+
+    if (*src != '\\') {
+      *dst++ = *src++;
+      continue;
+    }
+
+    src++;
+    if (src == end) {
+      /* A trailing backslash is malformed. */
+      errno = EINVAL;
+      return -1;
+    }
+
+    c = *src++;
+    switch (c) {
+      case 'b':
+        *dst++ = '\b';
+        break;
+
+      case 'f':
+        *dst++ = '\f';
+        break;
+
+      case 'n':
+        *dst++ = '\n';
+        break;
+
+      case 'r':
+        *dst++ = '\r';
+        break;
+
+      case 't':
+        *dst++ = '\t';
+        break;
+
+      case 'v':
+        *dst++ = '\v';
+        break;
+
+      case 'x': {
+        unsigned int val = 0, ndigits = 0;
+
+        while (src < end &&
+               ndigits < 2 &&
+               isxdigit((unsigned char) *src)) {
+          val = (val * 16) +
+            (isdigit((unsigned char) *src) ? *src - '0' :
+              (tolower((unsigned char) *src) - 'a' + 10));
+          src++;
+          ndigits++;
+        }
+
+        if (ndigits == 0) {
+          *dst++ = 'x';
+
+        } else {
+          *dst++ = (char) val;
+        }
+        break;
+      }
+
+      default:
+        if (c >= '0' && c <= '7') {
+          unsigned int val = c - '0', ndigits = 1;
+
+          while (src < end &&
+                 ndigits < 3 &&
+                 *src >= '0' && *src <= '7') {
+            val = (val * 8) + (*src - '0');
+            src++;
+            ndigits++;
+          }
+
+          *dst++ = (char) val;
+
+        } else {
+          *dst++ = c;
+        }
+        break;
+    }
+  }
+
+  *dst = '\0';
+  return 0;
+}
+
+int sqlconf_tree_split_copy_row(char *text, size_t textlen, char **fields,
+    unsigned int nfields) {
+  register unsigned int i;
+  char *ptr, *end;
+
+  if (text == NULL ||
+      fields == NULL ||
+      nfields == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  end = text + textlen;
+  if (textlen > 0 &&
+      *(end - 1) == '\n') {
+    end--;
+  }
+
+  ptr = text;
+  for (i = 0; i < nfields; i++) {
+    char *field, *sep;
+    size_t len;
+
+    field = ptr;
+    sep = memchr(ptr, '\t', end - ptr);
+    if (sep == NULL) {
+      if (i != nfields - 1) {
+        /* Too few fields. */
+        errno = EINVAL;
+        return -1;
+      }
+
+      sep = end;
+
+    } else if (i == nfields - 1) {
+      /* Too many fields. */
+      errno = EINVAL;
+      return -1;
+    }
+
+    len = sep - field;
+    ptr = sep + 1;
+
+    if (len == 2 &&
+        field[0] == '\\' &&
+        field[1] == 'N') {
+      fields[i] = NULL;
+      continue;
+    }
+
+    if (tree_unescape_field(field, len) < 0) {
+      return -1;
+    }
+
+    fields[i] = field;
+  }
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * ProFTPD - mod_conf_sql in-memory configuration tree API
+ * Copyright (c) 2016 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_conf_sql.h"
+#include "mod_sql.h"
+
+#ifndef MOD_CONF_SQL_TREE_H
+#define MOD_CONF_SQL_TREE_H
+
+/* An in-memory copy of the context and directive tables, loaded in bulk, and
+ * then queried using the same query shapes as the database itself.
+ */
+typedef struct sqlconf_tree_st sqlconf_tree_t;
+
+sqlconf_tree_t *sqlconf_tree_create(pool *p, int flags);
+
+/* Directive rows include the pre-tokenized arguments column. */
+#define CONF_SQL_TREE_FL_ARGV		0x0001
+
+/* Adds the given context to the tree; a NULL parent ID indicates a toplevel
+ * context.  Contexts not matching the configured WHERE clause are kept, for
+ * looking up the base context, but not returned as child contexts.
+ */
+int sqlconf_tree_add_ctx(sqlconf_tree_t *tree, const char *id,
+  const char *parent_id, const char *type, const char *value, int matched);
+
+/* Adds the given directive to the context with the given ID. */
+int sqlconf_tree_add_conf(sqlconf_tree_t *tree, const char *ctx_id,
+  const char *name, const char *value, const char *argv_text);
+
+/* Returns the results of the given query shape, for the given context ID,
+ * in the same form as mod_sql.  The returned values point into the tree.
+ */
+int sqlconf_tree_select(pool *p, sqlconf_tree_t *tree, unsigned int shape,
+  int ctx_id, const char *base_id, sql_data_t **sd);
+
+/* Returns the number of bytes allocated for the contexts and directives of
+ * the tree.
+ */
+size_t sqlconf_tree_get_size(sqlconf_tree_t *tree);
+
+/* Splits the given NUL-terminated row, in PostgreSQL's COPY text format,
+ * into the expected number of fields, unescaping them in place.  NULL fields
+ * ("\N") are returned as NULL.
+ */
+int sqlconf_tree_split_copy_row(char *text, size_t textlen, char **fields,
+  unsigned int nfields);
+
+#endif /* MOD_CONF_SQL_TREE_H */
@@ -27,9 +27,52 @@
 
 static const char *trace_channel = "conf_sql";
 
-static char *uri_parse_host(pool *p, const char *orig_uri, const char *uri,
-    char **remaining) {
-  char *host = NULL, *ptr = NULL;
+/* The values of the hexadecimal digits, by character, or -1. */
+static const signed char uri_hexvals[256] = {
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+  -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/* A part of the URI being parsed, which is not NUL-terminated.  The URI is
+ * split into these views in place; only the parts which are kept are
+ * copied, into a single buffer, once parsing has succeeded.
+ */
+struct uri_span {
+  const char *ptr;
+  size_t len;
+};
+
+/* Returns a copy of the given span, taken from the given buffer. */
+static char *uri_span_dup(char **buf, const struct uri_span *span) {
+  char *res;
+
+  res = *buf;
+  memcpy(res, span->ptr, span->len);
+  res[span->len] = '\0';
+
+  *buf += (span->len + 1);
+  return res;
+}
+
+static int uri_parse_host(const char *orig_uri, struct uri_span *uri,
+    struct uri_span *host) {
+  const char *ptr = NULL, *end;
+
+  end = uri->ptr + uri->len;
 
   /* We have either of:
    *
@@ -39,117 +82,124 @@ static char *uri_parse_host(pool *p, const char *orig_uri, const char *uri,
    * Look for an opening square bracket, to see if we have an IPv6 address
    * in the URI.
    */
-  if (uri[0] == '[') {
-    size_t urilen;
-
-    ptr = strchr(uri + 1, ']');
+  if (uri->len > 0 &&
+      uri->ptr[0] == '[') {
+    ptr = memchr(uri->ptr + 1, ']', uri->len - 1);
     if (ptr == NULL) {
       /* If there is no ']', then it's a badly-formatted URI. */
       pr_log_debug(DEBUG0, MOD_CONF_SQL_VERSION
         ": badly formatted IPv6 address in host info '%.200s'", orig_uri);
       errno = EINVAL;
-      return NULL;
+      return -1;
     }
 
-    host = pstrndup(p, uri + 1, ptr - uri - 1);
+    host->ptr = uri->ptr + 1;
+    host->len = ptr - host->ptr;
 
-    urilen = strlen(ptr);
-    if (urilen > 0) {
-      *remaining = ptr + 1;
-
-    } else {
-      *remaining = NULL;
-    }
+    uri->ptr = ptr + 1;
+    uri->len = end - uri->ptr;
+    return 0;
+  }
 
-    return host;
+  if (uri->len > 1) {
+    ptr = memchr(uri->ptr + 1, ':', uri->len - 1);
   }
 
-  ptr = strchr(uri + 1, ':');
   if (ptr == NULL) {
     /* IFF the host starts with a slash, THEN intepret the host as an
      * absolute path (e.g. for an SQLite database).  Otherwise, look for a
      * slash as the start of a path in the URI.
      */
 
-    if (uri[0] == '/') {
-      *remaining = NULL;
-      host = pstrdup(p, uri);
-
-      return host;
+    if (uri->len > 0 &&
+        uri->ptr[0] != '/') {
+      ptr = memchr(uri->ptr, '/', uri->len);
     }
 
-    ptr = strchr(uri, '/');
     if (ptr == NULL) {
-      *remaining = NULL;
-      host = pstrdup(p, uri);
+      *host = *uri;
 
-      return host;
+      uri->ptr = NULL;
+      uri->len = 0;
+      return 0;
     }
   }
 
-  *remaining = ptr;
+  host->ptr = uri->ptr;
+  host->len = ptr - uri->ptr;
 
-  host = pstrndup(p, uri, ptr - uri);
-  return host;
+  uri->ptr = ptr;
+  uri->len = end - ptr;
+  return 0;
 }
 
-static int uri_parse_port(pool *p, const char *orig_uri, const char *uri,
-    unsigned int *port, char **remaining) {
+/* Parses the port following the given colon, advancing the given URI to any
+ * path after it.
+ */
+static int uri_parse_port(const char *orig_uri, struct uri_span *uri,
+    const char *colon, unsigned int *port) {
   register unsigned int i;
-  char *ptr, *portspec;
+  const char *ptr, *portspec, *end;
   size_t portspeclen;
+  unsigned long portno = 0;
+
+  end = uri->ptr + uri->len;
+  portspec = colon + 1;
 
   /* Look for any possible trailing '/'. */
-  ptr = strchr(uri, '/');
+  ptr = memchr(colon, '/', end - colon);
   if (ptr == NULL) {
-    portspec = ((char *) uri) + 1;
-    portspeclen = strlen(portspec);
-    *remaining = NULL;
+    portspeclen = end - portspec;
+    uri->ptr = NULL;
+    uri->len = 0;
 
   } else {
-    portspeclen = ptr - (uri + 1);
-
-    *ptr = '\0';
-    portspec = pstrndup(p, ((char *) uri) + 1, portspeclen);
-    *ptr = '/';
-    *remaining = ptr;
+    portspeclen = ptr - portspec;
+    uri->ptr = ptr;
+    uri->len = end - ptr;
   }
 
   /* Ensure that only numeric characters appear in the portspec. */
   for (i = 0; i < portspeclen; i++) {
     if (PR_ISDIGIT((int) portspec[i]) == 0) {
       pr_log_debug(DEBUG2, MOD_CONF_SQL_VERSION
-        ": invalid character (%c) at index %d in port specification '%.200s'",
-        portspec[i], i, portspec);
+        ": invalid character (%c) at index %d in port specification '%.*s'",
+        portspec[i], i, (int) portspeclen, portspec);
       errno = EINVAL;
       return -1;
     }
+
+    /* Past this, the port is out of range anyway. */
+    if (portno < 65536) {
+      portno = (portno * 10) + (portspec[i] - '0');
+    }
   }
 
   /* The above check will rule out any negative numbers, since it will reject
    * the minus character.  Thus we only need to check for a zero port, or a
    * number that's outside the 1-65535 range.
    */
-  *port = atoi(portspec);
-  if (*port == 0 ||
-      *port >= 65536) {
+  if (portno == 0 ||
+      portno >= 65536) {
     pr_log_debug(DEBUG2, MOD_CONF_SQL_VERSION
-      ": port specification '%.200s' yields invalid port number %d",
-      portspec, *port);
+      ": port specification '%.*s' yields invalid port number %lu",
+      (int) portspeclen, portspec, portno);
     errno = EINVAL;
     return -1;
   }
 
+  *port = (unsigned int) portno;
   return 0;
 }
 
-/* Determine whether "username:password@" are present.  If so, then parse it
- * out, and return a pointer to the portion of the URI after the parsed-out
- * userinfo.
+/* Determine whether "username:password@" are present.  If so, then parse
+ * them out, and advance the given URI past the parsed-out userinfo.  Returns
+ * TRUE if a username and password were found.
  */
-static char *uri_parse_userinfo(pool *p, const char *orig_uri,
-    const char *uri, char **username, char **password) {
-  char *ptr, *ptr2, *rem_uri = NULL, *userinfo, *user = NULL, *passwd = NULL;
+static int uri_parse_userinfo(struct uri_span *uri, struct uri_span *user,
+    struct uri_span *passwd) {
+  const char *at = NULL, *colon, *end;
+  size_t i;
 
   /* We have either:
    *
@@ -165,107 +215,87 @@ static char *uri_parse_userinfo(pool *p, const char *orig_uri,
    *  user@domain.com:pass@word@host...
    *
    * all of which have at least one occurrence of the '@' character.
-   */
-
-  ptr = strchr(uri, '@');
-  if (ptr == NULL) {
-    /* No '@' character at all?  No user info, then. */
-
-    if (username != NULL) {
-      *username = NULL;
-    }
-
-    if (password != NULL) {
-      *password = NULL;
-    }
-
-    return pstrdup(p, uri);
-  }
-
-  /* To handle the case where the password field might itself contain an
-   * '@' character, we first search from the end for '@'.  If found, then we
-   * search for '@' from the beginning.  If also found, AND if both ocurrences
-   * are the same, then we have a plain "username:password@" string.
+   *
+   * To handle the case where the password field might itself contain an
+   * '@' character, we use the last '@' as the delimiter.
    *
    * Note that we can handle '@' characters within passwords (or usernames),
    * but we currently cannot handle ':' characters within usernames.
    */
 
-  ptr2 = strrchr(uri, '@');
-  if (ptr2 != NULL) {
-    if (ptr != ptr2) {
-      /* Use the last found '@' as the delimiter. */
-      ptr = ptr2;
+  end = uri->ptr + uri->len;
+  for (i = uri->len; i > 0; i--) {
+    if (uri->ptr[i-1] == '@') {
+      at = uri->ptr + i - 1;
+      break;
     }
   }
 
-  userinfo = pstrndup(p, uri, ptr - uri);
-  rem_uri = ptr + 1;
-
-  ptr = strchr(userinfo, ':');
-  if (ptr == NULL) {
-    if (username != NULL) {
-      *username = NULL;
-    }
+  if (at == NULL) {
+    /* No '@' character at all?  No user info, then. */
+    return FALSE;
+  }
 
-    if (password != NULL) {
-      *password = NULL;
-    }
+  colon = memchr(uri->ptr, ':', at - uri->ptr);
+  if (colon != NULL) {
+    user->ptr = uri->ptr;
+    user->len = colon - uri->ptr;
 
-    return rem_uri;
+    /* Watch for empty passwords. */
+    passwd->ptr = colon + 1;
+    passwd->len = at - passwd->ptr;
   }
 
-  user = pstrndup(p, userinfo, ptr - userinfo);
-  if (username != NULL) {
-    *username = user;
-  }
+  uri->ptr = at + 1;
+  uri->len = end - uri->ptr;
 
-  /* Watch for empty passwords. */
-  if (*(ptr+1) == '\0') {
-    passwd = pstrdup(p, "");
+  return (colon != NULL);
+}
 
-  } else {
-    passwd = pstrdup(p, ptr + 1);
-  }
+/* Checks that each "key=value" parameter in the given query string is well
+ * formed, adding the space needed for copies of them to the given size.
+ */
+static int uri_scan_params(const char *orig_uri, const struct uri_span *query,
+    size_t *bufsz) {
+  const char *kv, *amp, *end;
+  size_t kvlen;
 
-  if (password != NULL) {
-    *password = passwd;
-  }
+  kv = query->ptr;
+  end = query->ptr + query->len;
 
-  return rem_uri;
-}
+  while (TRUE) {
+    pr_signals_handle();
 
-static int uri_parse_kv(pool *p, const char *uri, char *kv, size_t kvlen,
-  char **k, size_t *klen, char **v, size_t *vlen) {
-  char *ptr;
+    amp = memchr(kv, '&', end - kv);
+    kvlen = (amp != NULL ? amp : end) - kv;
 
-  ptr = memchr(kv, '=', kvlen);
-  if (ptr == NULL) {
-    pr_log_debug(DEBUG1, MOD_CONF_SQL_VERSION
-      ": badly formatted query parameter '%.*s' in URI '%.200s'", (int) kvlen,
-      kv, uri);
-    errno = EINVAL;
-    return -1;
-  }
+    if (memchr(kv, '=', kvlen) == NULL) {
+      pr_log_debug(DEBUG1, MOD_CONF_SQL_VERSION
+        ": badly formatted query parameter '%.*s' in URI '%.200s'",
+        (int) kvlen, kv, orig_uri);
+      errno = EINVAL;
+      return -1;
+    }
 
-  *klen = ptr - kv;
-  *k = pstrndup(p, kv, *klen);
+    /* The key and value, less the '=', plus their NULs. */
+    *bufsz += (kvlen + 1);
 
-  *vlen = kvlen - *klen - 1;
-  *v = pstrndup(p, ptr + 1, *vlen);
+    if (amp == NULL) {
+      break;
+    }
+
+    kv = amp + 1;
+  }
 
   return 0;
 }
 
-static int uri_store_kv(pool *p, const char *uri, pr_table_t *params,
-    char *k, size_t klen, char *v, size_t vlen) {
+static int uri_store_kv(const char *uri, pr_table_t *params, char *k,
+    size_t klen, char *v, size_t vlen) {
   int res;
 
-  v = pstrndup(p, v, vlen);
-
   if (pr_table_count(params) == 0 ||
       pr_table_exists(params, k) == 0) {
-    k = pstrndup(p, k, klen);
     res = pr_table_add(params, k, v, vlen);
 
   } else {
@@ -289,82 +319,59 @@ static int uri_store_kv(pool *p, const char *uri, pr_table_t *params,
   return 0;
 }
 
-static int uri_parse_params(pool *p, const char *orig_uri, const char *uri,
-    pr_table_t *params) {
-  int res;
-  char *k, *v, *query_string, *ptr;
-  size_t klen = 0, vlen = 0, kvlen, query_stringlen;
-  pool *sub_pool;
+/* Copies each parameter, already checked by uri_scan_params(), from the
+ * given query string into the given buffer, and stores it.
+ */
+static int uri_store_params(const char *orig_uri,
+    const struct uri_span *query, char **buf, pr_table_t *params) {
+  const char *kv, *amp, *eq, *end;
 
-  sub_pool = make_sub_pool(p);
-  pr_pool_tag(sub_pool, "URI parameter pool");
+  kv = query->ptr;
+  end = query->ptr + query->len;
 
-  query_stringlen = strlen(uri);
-  query_string = pstrndup(sub_pool, uri, query_stringlen);
+  while (TRUE) {
+    struct uri_span key, val;
+    char *k, *v;
 
-  ptr = memchr(query_string, '&', query_stringlen);
-  while (ptr != NULL) {
-    pr_signals_handle();
+    amp = memchr(kv, '&', end - kv);
+    if (amp == NULL) {
+      amp = end;
+    }
 
-    k = v = NULL;
-    kvlen = vlen = 0;
+    eq = memchr(kv, '=', amp - kv);
 
-    kvlen = ptr - query_string;
-    res = uri_parse_kv(sub_pool, orig_uri, query_string, kvlen,
-      &k, &klen, &v, &vlen);
-    if (res < 0) {
-      /* Malformed "key=val" string. */
-      destroy_pool(sub_pool);
-      errno = EINVAL;
-      return -1;
-    }
+    key.ptr = kv;
+    key.len = eq - kv;
+    val.ptr = eq + 1;
+    val.len = amp - val.ptr;
 
-    res = uri_store_kv(p, orig_uri, params, k, klen, v, vlen);
-    if (res < 0) {
-      int xerrno = errno;
+    k = uri_span_dup(buf, &key);
+    v = uri_span_dup(buf, &val);
 
-      destroy_pool(sub_pool);
-      errno = xerrno;
+    if (uri_store_kv(orig_uri, params, k, key.len, v, val.len) < 0) {
       return -1;
     }
 
-    query_string = ptr + 1;
-    ptr = strchr(query_string, '&');
-  }
-
-  k = v = NULL;
-  klen = vlen = 0;
+    if (amp == end) {
+      break;
+    }
 
-  res = uri_parse_kv(sub_pool, orig_uri, query_string, query_stringlen,
-    &k, &klen, &v, &vlen);
-  if (res < 0) {
-    /* Malformed "key=val" string. */
-    destroy_pool(sub_pool);
-    errno = EINVAL;
-    return -1;
-  }
-
-  res = uri_store_kv(p, orig_uri, params, k, klen, v, vlen);
-  if (res < 0) {
-    int xerrno = errno;
-
-    destroy_pool(sub_pool);
-    errno = xerrno;
-    return -1;
+    kv = amp + 1;
   }
 
   /* Warn about unknown/unsupported keys, but do NOT error on them! */
 
-  destroy_pool(sub_pool);
   return 0;
 }
 
 int sqlconf_uri_parse(pool *p, const char *orig_uri, char **host,
     unsigned int *port, char **path, char **username, char **password,
     pr_table_t *params) {
-  pool *sub_pool;
-  char *ptr, *ptr2 = NULL, *uri;
-  size_t len;
+  struct uri_span uri, query, host_span, user_span, passwd_span;
+  const char *ptr;
+  char *buf;
+  size_t len, bufsz = 0;
+  int have_userinfo;
 
   if (p == NULL ||
       orig_uri == NULL ||
@@ -393,10 +400,8 @@ int sqlconf_uri_parse(pool *p, const char *orig_uri, char **host,
     return -1;
   }
 
-  sub_pool = make_sub_pool(p);
-
-  uri = pstrdup(sub_pool, orig_uri + 6);
-  ptr = uri;
+  uri.ptr = orig_uri + 6;
+  uri.len = len - 6;
 
   /* Possible URIs at this point:
    *
@@ -417,57 +422,79 @@ int sqlconf_uri_parse(pool *p, const char *orig_uri, char **host,
    *  username:password@[host]...
    */
 
-  ptr = strchr(uri, '?');
+  query.ptr = NULL;
+  query.len = 0;
+
+  ptr = memchr(uri.ptr, '?', uri.len);
   if (ptr != NULL) {
-    if (uri_parse_params(p, uri, ptr + 1, params) < 0) {
-      int xerrno = errno;
+    query.ptr = ptr + 1;
+    query.len = (uri.ptr + uri.len) - query.ptr;
+    uri.len = ptr - uri.ptr;
 
-      destroy_pool(sub_pool);
-      errno = xerrno;
+    if (uri_scan_params(orig_uri, &query, &bufsz) < 0) {
       return -1;
     }
-
-    *ptr = '\0';
   }
 
   /* Note: Will we want/need to support URL-encoded characters in the future? */
 
-  ptr = uri_parse_userinfo(sub_pool, uri, uri, username, password);
-
-  *host = uri_parse_host(sub_pool, uri, ptr, &ptr2);
-  if (*host == NULL) {
-    int xerrno = errno;
+  have_userinfo = uri_parse_userinfo(&uri, &user_span, &passwd_span);
 
-    destroy_pool(sub_pool);
-    errno = xerrno;
+  if (uri_parse_host(orig_uri, &uri, &host_span) < 0) {
     return -1;
   }
 
   /* Optional port field present? */
-  if (ptr2 != NULL) {
-    ptr = strchr(ptr2, ':');
+  if (uri.ptr != NULL) {
+    ptr = memchr(uri.ptr, ':', uri.len);
     if (ptr != NULL) {
-      if (uri_parse_port(sub_pool, uri, ptr, port, &ptr2) < 0) {
-        int xerrno = errno;
-
-        destroy_pool(sub_pool);
-        errno = xerrno;
+      if (uri_parse_port(orig_uri, &uri, ptr, port) < 0) {
         return -1;
       }
     }
+  }
+
+  /* Everything kept is copied into a single buffer. */
+  bufsz += host_span.len + 1;
 
-    if (ptr2 != NULL) {
-      *path = pstrdup(p, ptr2);
+  if (have_userinfo == TRUE) {
+    bufsz += user_span.len + 1 + passwd_span.len + 1;
+  }
+
+  if (uri.ptr != NULL) {
+    bufsz += uri.len + 1;
+  }
+
+  buf = palloc(p, bufsz);
+
+  if (query.ptr != NULL) {
+    if (uri_store_params(orig_uri, &query, &buf, params) < 0) {
+      return -1;
     }
   }
 
-  destroy_pool(sub_pool);
+  *host = uri_span_dup(&buf, &host_span);
+
+  if (have_userinfo == TRUE) {
+    *username = uri_span_dup(&buf, &user_span);
+    *password = uri_span_dup(&buf, &passwd_span);
+
+  } else {
+    *username = NULL;
+    *password = NULL;
+  }
+
+  if (uri.ptr != NULL) {
+    *path = uri_span_dup(&buf, &uri);
+  }
+
   return 0;
 }
 
 int sqlconf_uri_urldecode(pool *p, const char *src, size_t srcsz,
     char **dst, size_t *dstsz) {
-  char a, b, *ptr;
+  const char *end, *pct, *plus, *nul;
+  char *ptr;
 
   if (p == NULL ||
       src == NULL ||
@@ -477,63 +504,94 @@ int sqlconf_uri_urldecode(pool *p, const char *src, size_t srcsz,
     return -1;
   }
 
+  /* As for any C string, decoding stops at the first NUL. */
+  nul = memchr(src, '\0', srcsz);
+  if (nul != NULL) {
+    srcsz = nul - src;
+  }
+
   if (srcsz == 0) {
     *dstsz = 0;
     *dst = pstrdup(p, "");
     return 0;
   }
 
-  /* ASSUME that the decoded version will be smaller, thus we make a copy
-   * of the source string, and decode in place.
-   *
-   * Implementation borrowed from:
-   *  http://stackoverflow.com/questions/2673207/c-c-url-decode-library
+  /* The decoded string is never longer than the encoded one.  Runs of plain
+   * characters are copied as is; only the '%' and '+' characters between
+   * them need decoding, so we scan ahead for the next of each.
    */
+  *dst = ptr = palloc(p, srcsz + 1);
+  end = src + srcsz;
 
-  *dst = ptr = pcalloc(p, srcsz+1);
+  pct = memchr(src, '%', srcsz);
+  plus = memchr(src, '+', srcsz);
 
-  while (*src) {
-    pr_signals_handle();
+  while (src < end) {
+    const char *next;
 
-    if ((*src == '%') &&
-        ((a = src[1]) && (b = src[2])) &&
-        (PR_ISXDIGIT(a) && PR_ISXDIGIT(b))) {
-      if (a >= 'a') {
-        a -= 'a'-'A';
-      }
+    if (pct != NULL &&
+        pct < src) {
+      pct = memchr(src, '%', end - src);
+    }
 
-      if (a >= 'A') {
-        a -= ('A' - 10);
+    if (plus != NULL &&
+        plus < src) {
+      plus = memchr(src, '+', end - src);
+    }
 
-      } else {
-        a -= '0';
-      }
+    next = end;
+    if (pct != NULL &&
+        pct < next) {
+      next = pct;
+    }
 
-      if (b >= 'a') {
-        b -= 'a'-'A';
-      }
+    if (plus != NULL &&
+        plus < next) {
+      next = plus;
+    }
 
-      if (b >= 'A') {
-        b -= ('A' - 10);
+    if (next > src) {
+      memcpy(ptr, src, next - src);
+      ptr += (next - src);
+      src = next;
 
-      } else {
-        b -= '0';
+      if (src == end) {
+        break;
       }
+    }
 
-      *ptr++ = (16 * a) + b;
-      src += 3;
-
-    } else if (*src == '+') {
+    if (*src == '+') {
       *ptr++ = ' ';
       src++;
+      continue;
+    }
+
+    if (end - src >= 3) {
+      int hi, lo;
+
+      hi = uri_hexvals[(unsigned char) src[1]];
+      lo = uri_hexvals[(unsigned char) src[2]];
 
-    } else {
-      *ptr++ = *src++;
+      if (hi >= 0 &&
+          lo >= 0) {
+        if (hi == 0 &&
+            lo == 0) {
+          /* An encoded NUL ends the decoded string. */
+          break;
+        }
+
+        *ptr++ = (char) ((hi << 4) | lo);
+        src += 3;
+        continue;
+      }
     }
+
+    /* Not a valid escape; keep the '%' as is. */
+    *ptr++ = *src++;
   }
 
-  *ptr++ = '\0';
-  *dstsz = strlen(*dst);
+  *ptr = '\0';
+  *dstsz = ptr - *dst;
 
   return 0;
 }
@@ -38,7 +38,9 @@
 int sqlconf_uri_parse(pool *p, const char *uri, char **host, unsigned int *port,
   char **path, char **username, char **password, pr_table_t *params);
 
-/* Returns a URL-decoded version of the given string. */
+/* Returns a URL-decoded version of the given string, of at most the given
+ * size; decoding stops at the first NUL, whether encoded ("%00") or not.
+ */
 int sqlconf_uri_urldecode(pool *p, const char *src, size_t srcsz, char **dst,
   size_t *dstsz);
 